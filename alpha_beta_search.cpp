@@ -1,10 +1,49 @@
 #include "alpha_beta_search.h"
 #include "moveorder.h"
 
-int AlphaBeta::quiesce(Board& board, int alpha, int beta)
+int AlphaBeta::evaluate(Board& board)
+{
+    if (use_nnue) return nnue_stack.evaluate(board);
+
+    // the same positions come back at every iteration and through transpositions, so look for a stored eval first
+    int score;
+    stats.eval_probes++;
+    if (evaluator.probe_eval(board.get_hash(), score))
+    {
+        stats.eval_hits++;
+        return score;
+    }
+
+    score = evaluator.eval(board);
+    evaluator.store_eval(board.get_hash(), score);
+    return score;
+}
+
+int AlphaBeta::evaluate(Board& board, int alpha, int beta)
 {
-    // get static eval 
-    int static_eval = Evaluate::eval(board);
+    if (use_nnue) return nnue_stack.evaluate(board);
+
+    int score;
+    stats.eval_probes++;
+    if (evaluator.probe_eval(board.get_hash(), score))
+    {
+        stats.eval_hits++;
+        return score;
+    }
+
+    // only a full eval is exact enough to be cached
+    bool early_exit;
+    score = evaluator.eval(board, alpha, beta, early_exit);
+    if (early_exit) stats.eval_lazy_exits++;
+    else evaluator.store_eval(board.get_hash(), score);
+    return score;
+}
+
+template<int features>
+int AlphaBeta::quiesce_kernel(Board& board, int alpha, int beta)
+{
+    // get static eval; only which side of the window it falls on matters here, so it may stop early
+    int static_eval = evaluate(board, alpha, beta);
 
     // static eval = stand pat score
     int best_value = static_eval;
@@ -17,7 +56,7 @@ int AlphaBeta::quiesce(Board& board, int alpha, int beta)
     // examine all captures
     MoveList moves;
     board.generate_pseudo_legal_moves(moves);
-    order_moves(board, moves, move_order_flags, {null, null, QUIET});
+    order_moves<(features >> FEATURE_ORDER_SHIFT)>(board, moves, {null, null, QUIET}, nullptr);
     
     for (int i = 0; i < moves.count; i++)
     {
@@ -31,7 +70,7 @@ int AlphaBeta::quiesce(Board& board, int alpha, int beta)
             int score = -MAX_BOUND;
             if ( !board.in_check( static_cast<Color>( 1-board.get_side_to_move() ) ) )
             {
-                score = -quiesce(board, -beta, -alpha);
+                score = -quiesce_kernel<features>(board, -beta, -alpha);
             }
 
             // undo move
@@ -48,10 +87,17 @@ int AlphaBeta::quiesce(Board& board, int alpha, int beta)
     return alpha;
 }
 
-int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
+template<NodeType node_type, int features>
+int AlphaBeta::search_kernel(Board& board, int alpha, int beta, int depth, int ply)
 {
-    // address basic draw conditions
-    if (board.is_50_move_draw() || board.is_insufficient_material() || board.is_repeat()) 
+    constexpr bool root_node = node_type == ROOT_NODE;
+    constexpr bool pv_node = node_type != NON_PV_NODE;
+
+    // reset this ply's pv and the child's killers
+    init_ply(ply);
+
+    // address basic draw conditions (the root's were handled when its moves were built)
+    if (!root_node && (board.is_50_move_draw() || board.is_insufficient_material() || board.is_repeat()))
     {
         return DRAW_SCORE;
     }
@@ -62,38 +108,95 @@ int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
         return -TIME_SCORE;
     }
 
+    // positions the tables cover are scored exactly, distance to mate included
+    int tb_value;
+    if (!root_node && use_tablebases && Tablebases::probe(board, tb_value))
+    {
+        stats.tb_hits++;
+        return Tablebases::to_score(tb_value, ply);
+    }
+
     // track original alpha
     int original_alpha = alpha;
 
-    // check for transposition table hit
-    TTEntry tt_hit = tt.probe(board.get_hash(), ply);
+    // check for transposition table hit (never cut at pv nodes, so the root always produces a best move and the pv comes out whole)
+    TTData tt_hit = tt.probe(board.get_hash(), ply);
     Move best_move_in_this_position = tt_hit.best_move;
-    if (search_flags.transposition && tt_hit.depth >= depth)
+    stats.tt_probes++;
+    if (tt_hit.depth >= 0) stats.tt_hits++;
+    if ((features & FEATURE_TRANSPOSITION) && !pv_node && tt_hit.depth >= depth)
     {
-        if (tt_hit.node_type == EXACT) return tt_hit.score;
+        if (tt_hit.node_type == EXACT)
+        {
+            stats.tt_cutoffs++;
+            return tt_hit.score;
+        }
         else if (tt_hit.node_type == LOWER_BOUND) alpha = max(alpha, tt_hit.score);
         else beta = min(beta, tt_hit.score);
-        if (alpha >= beta) return alpha;
+        if (alpha >= beta)
+        {
+            stats.tt_cutoffs++;
+            return alpha;
+        }
     }
 
     // increment nodes searched
     stats.nodes_searched++;
 
-    // return static eval of position at leaf node
-    if (depth == 0) return quiesce(board, alpha, beta);
+    // return static eval of position at leaf node (or once the stack is exhausted)
+    if (depth == 0 || ply >= MAX_PLY - 1) return quiesce_kernel<features>(board, alpha, beta);
 
-    // generate pseudo legal moves
+    // the root walks the moves its multi-pv line still owns, already in order; other nodes start with just the hash move
     int best_score = -MAX_BOUND;
     int legal_moves = 0;
     MoveList moves;
-    board.generate_pseudo_legal_moves(moves);
-    order_moves(board, moves, move_order_flags, best_move_in_this_position);
+    bool generated = root_node;
+    if (root_node)
+    {
+        for (int i = pv_index; i < root_moves.count; i++) moves.add(root_moves.moves[i].move);
+    }
+    else
+    {
+        // a hit whose move can't be played here belongs to another position sharing the key fragment
+        if (tt_hit.best_move.from != null && !board.is_pseudo_legal(tt_hit.best_move))
+        {
+            stats.tt_collisions++;
+            best_move_in_this_position = {null, null, QUIET};
+        }
+
+        // previous iteration's pv move is searched first while we are still on that line, then the tt move;
+        // a later multi-pv line can start from a different root move than last time, so the pv move is checked too
+        if (pv_node)
+        {
+            Move pv_move = get_pv_move(ply);
+            if (pv_move.from != null && board.is_pseudo_legal(pv_move)) best_move_in_this_position = pv_move;
+        }
+        if (best_move_in_this_position.from != null) moves.add(best_move_in_this_position);
+    }
 
     // loop through each move
-    for (int i = 0; i < moves.count; i++)
+    for (int i = 0; i < moves.count || !generated; i++)
     {
-        // make move 
+        // the hash move didn't cut off, so generate and order the rest of the moves behind it
+        if (!generated && i == moves.count)
+        {
+            generated = true;
+            MoveList rest;
+            board.generate_pseudo_legal_moves(rest);
+            order_moves<(features >> FEATURE_ORDER_SHIFT)>(board, rest, best_move_in_this_position, stack[ply].killers);
+
+            bool has_hash_move = moves.count > 0;
+            for (int j = 0; j < rest.count; j++)
+            {
+                if (!has_hash_move || !same_move(rest.moves[j], moves.moves[0])) moves.add(rest.moves[j]);
+            }
+            if (i == moves.count) break;
+        }
+
+        // make move, fetching the child's tt cluster while the move is applied
         Move m = moves.moves[i];
+        int nodes_before = stats.nodes_searched;
+        tt.prefetch(board.key_after(m));
         PreviousState prev = board.make_move(m);
 
         // evaluate move if its legal
@@ -101,19 +204,34 @@ int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
         if ( !board.in_check( static_cast<Color>( 1-board.get_side_to_move() ) ) )
         {
             legal_moves++;
-            int extension = get_extension(board);
-            move_score = -search(board, -beta, -alpha, depth-1+extension, ply+1);
+            int extension = get_extension<features>(board);
+
+            // only the first move of a pv node can continue the previous pv, so only it is searched as a pv node
+            if (pv_node && legal_moves == 1) move_score = -search_kernel<PV_NODE, features>(board, -beta, -alpha, depth-1+extension, ply+1);
+            else move_score = -search_kernel<NON_PV_NODE, features>(board, -beta, -alpha, depth-1+extension, ply+1);
+
+            // only the first move searched can continue the previous pv
+            follow_pv = false;
         }
 
         // undo move
         board.unmake_move(m, prev);
 
+        // record subtree size and score for reordering; root moves that don't become best only have an upper bound
+        if (root_node)
+        {
+            RootMove& root_move = root_moves.moves[pv_index + i];
+            root_move.nodes = stats.nodes_searched - nodes_before;
+            root_move.score = move_score > best_score ? move_score : -MAX_BOUND;
+        }
+
         // if score better than current best score, make this our best score and best move if ply == 0
         if (move_score > best_score)
         {
-            if (ply == 0) best_move = m;
+            if (root_node || ply == 0) best_move = m;
             best_score = move_score;
             best_move_in_this_position = m;
+            update_pv(ply, m);
 
             // if better score found, update alpha
             alpha = max(alpha, best_score);
@@ -122,11 +240,15 @@ int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
         // beta cutoff
         if (alpha >= beta) 
         {
-            tt.add(board.get_hash(), best_move_in_this_position, LOWER_BOUND, alpha, depth, ply);
+            update_killers(ply, m);
+            if (!root_node || pv_index == 0) stats.tt_stores[tt.add(board.get_hash(), best_move_in_this_position, LOWER_BOUND, alpha, depth, ply)]++;
             return alpha; 
         }
     }
 
+    // later multi-pv lines only see part of the root's moves, so they don't describe the root position
+    if (root_node && pv_index > 0) return alpha;
+
     // address checkmate and draws
     if (legal_moves == 0)
     {
@@ -134,25 +256,131 @@ int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
         if (board.in_check(board.get_side_to_move())) score = -CHECKMATE_SCORE + ply;
         else score = DRAW_SCORE;
 
-        tt.add(board.get_hash(), best_move_in_this_position, EXACT, score, depth, ply);
+        stats.tt_stores[tt.add(board.get_hash(), best_move_in_this_position, EXACT, score, depth, ply)]++;
 
         return score;
     }
 
     // if alpha improves, but not too much, store exact score
-    if (alpha > original_alpha) tt.add(board.get_hash(), best_move_in_this_position, EXACT, alpha, depth, ply);
+    if (alpha > original_alpha) stats.tt_stores[tt.add(board.get_hash(), best_move_in_this_position, EXACT, alpha, depth, ply)]++;
 
     // if no move improved alpha, then alpha acts as an upper bound to the true score of this position 
-    else tt.add(board.get_hash(), best_move_in_this_position, UPPER_BOUND, alpha, depth, ply);
+    else stats.tt_stores[tt.add(board.get_hash(), best_move_in_this_position, UPPER_BOUND, alpha, depth, ply)]++;
 
     return alpha; 
 }
 
+template<int features>
 int AlphaBeta::get_extension(Board& board)
 {
     int extension = 0;
 
-    if (search_flags.check_extend && board.in_check(board.get_side_to_move())) extension++;
+    if ((features & FEATURE_CHECK_EXTEND) && board.in_check(board.get_side_to_move())) extension++;
 
     return extension;
+}
+
+int AlphaBeta::get_feature_set()
+{
+    int features = get_order_flags(move_order_flags) << FEATURE_ORDER_SHIFT;
+    if (search_flags.check_extend) features |= FEATURE_CHECK_EXTEND;
+    if (search_flags.transposition) features |= FEATURE_TRANSPOSITION;
+    return features;
+}
+
+template<int... feature_sets>
+AlphaBeta::QuiesceKernel AlphaBeta::select_quiesce_kernel(int feature_set, std::integer_sequence<int, feature_sets...>)
+{
+    static const QuiesceKernel kernels[] = { &AlphaBeta::quiesce_kernel<feature_sets>... };
+    return kernels[feature_set];
+}
+
+template<NodeType node_type, int... feature_sets>
+AlphaBeta::SearchKernel AlphaBeta::select_search_kernel(int feature_set, std::integer_sequence<int, feature_sets...>)
+{
+    static const SearchKernel kernels[] = { &AlphaBeta::search_kernel<node_type, feature_sets>... };
+    return kernels[feature_set];
+}
+
+int AlphaBeta::quiesce(Board& board, int alpha, int beta)
+{
+    QuiesceKernel kernel = select_quiesce_kernel(get_feature_set(), std::make_integer_sequence<int, NUM_FEATURE_SETS>());
+    return (this->*kernel)(board, alpha, beta);
+}
+
+int AlphaBeta::search(Board& board, int alpha, int beta, int depth, int ply)
+{
+    SearchKernel kernel = select_search_kernel<PV_NODE>(get_feature_set(), std::make_integer_sequence<int, NUM_FEATURE_SETS>());
+    return (this->*kernel)(board, alpha, beta, depth, ply);
+}
+
+int AlphaBeta::search_root(Board& board, int alpha, int beta, int depth)
+{
+    SearchKernel kernel = select_search_kernel<ROOT_NODE>(get_feature_set(), std::make_integer_sequence<int, NUM_FEATURE_SETS>());
+    int score = (this->*kernel)(board, alpha, beta, depth, 0);
+
+    // a line that became best after the first move can still run into an exact hit, so finish it from the table
+    extend_pv(board, depth);
+    return score;
+}
+
+void AlphaBeta::extend_pv(Board& board, int depth)
+{
+    SearchStackEntry& root = stack[0];
+    PreviousState states[MAX_PLY];
+    int played = 0;
+    for (; played < root.pv_length; played++) states[played] = board.make_move(root.pv[played]);
+
+    // follow the table's moves while they are legal and don't repeat a position
+    while (root.pv_length < min(depth, MAX_PLY - 1))
+    {
+        Move m = tt.probe(board.get_hash(), played).best_move;
+        if (m.from == null || !board.is_pseudo_legal(m)) break;
+
+        Color side = board.get_side_to_move();
+        states[played] = board.make_move(m);
+        if (board.in_check(side) || board.is_repeat())
+        {
+            board.unmake_move(m, states[played]);
+            break;
+        }
+        root.pv[root.pv_length++] = m;
+        played++;
+    }
+
+    while (played > 0)
+    {
+        played--;
+        board.unmake_move(root.pv[played], states[played]);
+    }
+}
+
+void AlphaBeta::new_search(Board& board)
+{
+    // evaluate with the network if asked to and one is loaded; its accumulators follow the board from here on
+    use_nnue = search_flags.nnue && NNUE::is_loaded();
+    if (use_nnue)
+    {
+        board.set_nnue(&nnue_stack);
+        nnue_stack.reset(board);
+    }
+    use_tablebases = search_flags.tablebases && Tablebases::get_table_count() > 0;
+
+    // age the table and start this search's table and eval cache counters from zero
+    tt.new_search();
+    stats.tt_probes = 0;
+    stats.tt_hits = 0;
+    stats.tt_cutoffs = 0;
+    stats.tt_collisions = 0;
+    for (int i = 0; i < NUM_TT_STORES; i++) stats.tt_stores[i] = 0;
+    stats.eval_probes = 0;
+    stats.eval_hits = 0;
+    stats.eval_lazy_exits = 0;
+    stats.tb_hits = 0;
+}
+
+void AlphaBeta::end_search(Board& board)
+{
+    // the caller keeps playing on this board, so stop pushing accumulators for it
+    board.set_nnue(nullptr);
 }
\ No newline at end of file
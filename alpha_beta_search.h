@@ -2,19 +2,65 @@
 #include "negamax.h"
 #include "evaluate.h"
 #include "transposition.h"
+#include "nnue.h"
+#include <utility>
 
-class AlphaBeta : public Negamax
+// node types the search kernel is specialized on
+typedef enum NodeType {
+    ROOT_NODE,
+    PV_NODE,
+    NON_PV_NODE
+} NodeType;
+
+// search features packed into bits; move ordering flags sit above the search flags
+#define FEATURE_CHECK_EXTEND 1
+#define FEATURE_TRANSPOSITION 2
+#define FEATURE_ORDER_SHIFT 2
+#define NUM_FEATURE_SETS (4 * NUM_ORDER_SETS)
+
+class AlphaBeta final : public Negamax
 {
     private:
         TranspositionTable tt;
+
+        // network accumulators, used when the nnue flag is set and a network is loaded
+        NNUEStack nnue_stack;
+        bool use_nnue = false;
+        int evaluate(Board& board);
+        int evaluate(Board& board, int alpha, int beta);
+
+        // probe the endgame tables inside the tree, when the flag is set and some are loaded
+        bool use_tablebases = false;
+
+        // compile-time specialized kernels
+        template<int features> int quiesce_kernel(Board& board, int alpha, int beta);
+        template<NodeType node_type, int features> int search_kernel(Board& board, int alpha, int beta, int depth, int ply);
+        template<int features> int get_extension(Board& board);
+        void extend_pv(Board& board, int depth);
+
+        // runtime flags -> kernel specialization, for comparing feature sets in a gauntlet
+        typedef int (AlphaBeta::*QuiesceKernel)(Board&, int, int);
+        typedef int (AlphaBeta::*SearchKernel)(Board&, int, int, int, int);
+        int get_feature_set();
+        template<int... feature_sets> static QuiesceKernel select_quiesce_kernel(int feature_set, std::integer_sequence<int, feature_sets...>);
+        template<NodeType node_type, int... feature_sets> static SearchKernel select_search_kernel(int feature_set, std::integer_sequence<int, feature_sets...>);
     public:
         // constructor
-        AlphaBeta() { move_order_flags = {true, true}; search_flags = {true, true}; tt.clear_table(); }
+        AlphaBeta() { move_order_flags = {true, true, true}; search_flags = {true, true, true, true}; }
+
+        // setters
+        void set_hash_size(u64 megabytes) override { tt.resize(megabytes); }
+
+        // snapshots
+        bool save_hash(string file_name) override { return tt.save(file_name); }
+        bool map_hash(string file_name) override { return tt.map_file(file_name); }
 
         // search
         int quiesce(Board& board, int alpha, int beta);
         int search(Board& board, int alpha, int beta, int depth, int ply) override;
-
-        // selectivity
-        int get_extension(Board& board);
+        int search_root(Board& board, int alpha, int beta, int depth) override;
+        void new_search(Board& board) override;
+        void end_search(Board& board) override;
+        void new_game() override { tt.clear_table(); }
+        void report_stats(int depth) override { progress->on_stats(depth, stats, tt.hashfull()); }
 };
\ No newline at end of file
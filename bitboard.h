@@ -3,6 +3,15 @@
 // 64-bit unsigned integer
 typedef unsigned long long u64; 
 
+// 32-bit unsigned integer
+typedef unsigned int u32;
+
+// 16-bit unsigned integer
+typedef unsigned short u16;
+
+// 8-bit unsigned integer
+typedef unsigned char u8;
+
 // return number of set bits in bitboard using gcc's builtin popcount method
 int pop_count(u64 bitboard);
 
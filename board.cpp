@@ -1,5 +1,8 @@
 #include "board.h"
 #include "sliding.h"
+#include "evaluate.h"
+#include "nnue.h"
+#include "kpk.h"
 #include <iostream>
 #include <chrono>
 #include <fstream>
@@ -9,11 +12,15 @@ unordered_map<u64, vector<Move>> Board::opening_book;
 
 Board::Board()
 {
+    nnue = nullptr;
+    weights = Evaluator::default_weights().get();
     from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 }
 
 Board::Board(string fen)
 {
+    nnue = nullptr;
+    weights = Evaluator::default_weights().get();
     from_fen(fen);
 }
 
@@ -112,11 +119,35 @@ void Board::from_fen(string fen)
     i++;
     full_moves = stoi(fen.substr(i, fen.length() - i));
 
+    reset_state();
+}
+
+void Board::set_position(u64 occupancies[NUM_COLORS][NUM_PIECES], Color side)
+{
+    // bare position: no castling, no en passant, fresh move counters
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        for (int piece = 0; piece < NUM_PIECES; piece++) piece_occupancies[color][piece] = occupancies[color][piece];
+        king_castle_ability[color] = false;
+        queen_castle_ability[color] = false;
+    }
+    side_to_move = side;
+    en_passant_square = null;
+    half_moves = 0;
+    full_moves = 1;
+
+    reset_state();
+}
+
+void Board::reset_state()
+{
     // calibrate
     calibrate_occupancies();
+    calibrate_scores();
 
-    // generate zobrist hash
+    // generate zobrist hash, and the pawn-only hash pawn structure is cached on
     hash = 0ULL;
+    pawn_hash = 0ULL;
     for (int color = 0; color < NUM_COLORS; color++)
     {
         for (int piece = 0; piece < NUM_PIECES; piece++)
@@ -129,6 +160,7 @@ void Board::from_fen(string fen)
                 int sq = lsb(occ);
 
                 hash ^= piece_zobrists[color][piece][sq]; 
+                if (piece == pawn) pawn_hash ^= piece_zobrists[color][piece][sq];
 
                 // reset lsb 
                 occ &= (occ - 1); 
@@ -290,6 +322,48 @@ u64 Board::get_hash()
     return hash;
 }
 
+u64 Board::get_pawn_hash()
+{
+    return pawn_hash;
+}
+
+Square Board::get_en_passant_square()
+{
+    return en_passant_square;
+}
+
+bool Board::has_castling_rights()
+{
+    return king_castle_ability[WHITE] || king_castle_ability[BLACK] || queen_castle_ability[WHITE] || queen_castle_ability[BLACK];
+}
+
+int Board::get_mg_score()
+{
+    return mg_score;
+}
+
+int Board::get_eg_score()
+{
+    return eg_score;
+}
+
+int Board::get_phase()
+{
+    return phase;
+}
+
+void Board::set_nnue(NNUEStack* stack)
+{
+    nnue = stack;
+}
+
+void Board::set_eval_weights(const EvalWeights* new_weights)
+{
+    // nullptr goes back to the defaults; either way the running scores have to be redone under the new tables
+    weights = new_weights != nullptr ? new_weights : Evaluator::default_weights().get();
+    calibrate_scores();
+}
+
 void Board::calibrate_occupancies()
 {
     // zero out side occupancies
@@ -312,6 +386,47 @@ void Board::recalibrate_occupancies(Color side, Piece piece, Square sq)
 
     piece_occupancies[side][piece] ^= mask;
     side_occupancy[side] ^= mask;
+    if (piece == pawn) pawn_hash ^= piece_zobrists[side][pawn][sq];
+
+    // the piece either just arrived on or just left the square
+    if (piece_occupancies[side][piece] & mask)
+    {
+        mg_score += weights->mg_psqt[side][piece][sq];
+        eg_score += weights->eg_psqt[side][piece][sq];
+        phase += piece_phases[piece];
+    }
+    else
+    {
+        mg_score -= weights->mg_psqt[side][piece][sq];
+        eg_score -= weights->eg_psqt[side][piece][sq];
+        phase -= piece_phases[piece];
+    }
+
+    // let the network's accumulator for this ply know which columns changed
+    if (nnue != nullptr) nnue->record(side, piece, sq, (piece_occupancies[side][piece] & mask) != 0);
+}
+
+void Board::calibrate_scores()
+{
+    // score every piece from scratch
+    mg_score = 0;
+    eg_score = 0;
+    phase = 0;
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        for (int piece = 0; piece < NUM_PIECES; piece++)
+        {
+            u64 occ = piece_occupancies[color][piece];
+            while (occ > 0)
+            {
+                int sq = lsb(occ);
+                mg_score += weights->mg_psqt[color][piece][sq];
+                eg_score += weights->eg_psqt[color][piece][sq];
+                phase += piece_phases[piece];
+                occ &= (occ - 1);
+            }
+        }
+    }
 }
 
 Piece Board::piece_at_square_for_side(Square sq, Color side)
@@ -382,6 +497,46 @@ bool Board::in_check(Color side)
     return side_attacked_on_square(side, static_cast<Square>(lsb(piece_occupancies[side][king])));
 }
 
+bool Board::in_check(Color side, AttackInfo& attacks)
+{
+    return (attacks.by_side[1-side] & piece_occupancies[side][king]) > 0;
+}
+
+void Board::compute_attacks(AttackInfo& attacks)
+{
+    u64 full_occupancy = side_occupancy[WHITE] | side_occupancy[BLACK];
+
+    // one lookup per piece; sliders see the board as it stands, without x-rays
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        attacks.by_side[color] = 0ULL;
+        for (int piece = 0; piece < NUM_PIECES; piece++)
+        {
+            attacks.by_piece[color][piece] = 0ULL;
+            u64 occ = piece_occupancies[color][piece];
+            while (occ > 0)
+            {
+                int sq = lsb(occ);
+                u64 piece_attack;
+                switch (piece)
+                {
+                    case pawn: piece_attack = pawn_attacks[color][sq]; break;
+                    case knight: piece_attack = knight_attacks[sq]; break;
+                    case bishop: piece_attack = get_bishop_attack(sq, full_occupancy); break;
+                    case rook: piece_attack = get_rook_attack(sq, full_occupancy); break;
+                    case queen: piece_attack = get_queen_attack(sq, full_occupancy); break;
+                    default: piece_attack = king_attacks[sq]; break;
+                }
+
+                attacks.piece_attacks[sq] = piece_attack;
+                attacks.by_piece[color][piece] |= piece_attack;
+                occ &= (occ - 1);
+            }
+            attacks.by_side[color] |= attacks.by_piece[color][piece];
+        }
+    }
+}
+
 /* METHODS FOR MOVE GENERATION */
 void Board::add_moves(MoveList &moves, Square from_square, u64 to_squares_bitboard, MoveType type)
 {
@@ -398,19 +553,28 @@ void Board::add_moves(MoveList &moves, Square from_square, u64 to_squares_bitboa
 // normal moves
 void Board::generate_pawn_moves(MoveList &moves)
 {
+    if (side_to_move == WHITE) generate_pawn_moves<WHITE>(moves);
+    else generate_pawn_moves<BLACK>(moves);
+}
+
+template<Color side>
+void Board::generate_pawn_moves(MoveList &moves)
+{
+    constexpr Color enemy = side == WHITE ? BLACK : WHITE;
+
     // get separate bitboards for pawn promotions, pawn double pushes, and pawn single pushes
     u64 full_occupancy = side_occupancy[WHITE] | side_occupancy[BLACK];
-    u64 pawns = piece_occupancies[side_to_move][pawn];
-    u64 promo_pawns = pawns & rank_masks[rank_7 - 5 * side_to_move];
-    u64 starting_pawns = pawns & rank_masks[rank_2 + 5 * side_to_move];
+    u64 pawns = piece_occupancies[side][pawn];
+    u64 promo_pawns = pawns & rank_masks[rank_7 - 5 * side];
+    u64 starting_pawns = pawns & rank_masks[rank_2 + 5 * side];
     u64 single_push_pawns = pawns ^ promo_pawns ^ starting_pawns;
 
     while (single_push_pawns > 0)
     {
         Square from = static_cast<Square>(lsb(single_push_pawns));
 
-        u64 to_squares = pawn_pushes[side_to_move][from] & ~full_occupancy;
-        u64 captures = pawn_attacks[side_to_move][from] & side_occupancy[1-side_to_move];
+        u64 to_squares = pawn_pushes[side][from] & ~full_occupancy;
+        u64 captures = pawn_attacks[side][from] & side_occupancy[enemy];
         if (to_squares > 0)
         {
             Square to = static_cast<Square>(lsb(to_squares));
@@ -425,10 +589,10 @@ void Board::generate_pawn_moves(MoveList &moves)
     {
         Square from = static_cast<Square>(lsb(starting_pawns));
 
-        u64 to_squares = get_rook_attack(from, full_occupancy ^ (1ULL << from)) & pawn_pushes[side_to_move][from] & ~full_occupancy;
-        u64 double_push_squares = to_squares & rank_masks[rank_4 + 1 * side_to_move];
+        u64 to_squares = get_rook_attack(from, full_occupancy ^ (1ULL << from)) & pawn_pushes[side][from] & ~full_occupancy;
+        u64 double_push_squares = to_squares & rank_masks[rank_4 + 1 * side];
         u64 single_push_squares = to_squares ^ double_push_squares;
-        u64 captures = pawn_attacks[side_to_move][from] & side_occupancy[1-side_to_move];
+        u64 captures = pawn_attacks[side][from] & side_occupancy[enemy];
 
         if (double_push_squares > 0)
         {
@@ -450,8 +614,8 @@ void Board::generate_pawn_moves(MoveList &moves)
     {
         Square from = static_cast<Square>(lsb(promo_pawns));
 
-        u64 to_squares = pawn_pushes[side_to_move][from] & ~full_occupancy;
-        u64 captures = pawn_attacks[side_to_move][from] & side_occupancy[1-side_to_move];
+        u64 to_squares = pawn_pushes[side][from] & ~full_occupancy;
+        u64 captures = pawn_attacks[side][from] & side_occupancy[enemy];
 
         if (to_squares > 0)
         {
@@ -579,6 +743,13 @@ void Board::generate_normal_moves(MoveList &moves)
 
 // special moves
 void Board::generate_en_passant(MoveList &moves)
+{
+    if (side_to_move == WHITE) generate_en_passant<WHITE>(moves);
+    else generate_en_passant<BLACK>(moves);
+}
+
+template<Color side>
+void Board::generate_en_passant(MoveList &moves)
 {
     // check if there's a valid en passant square
     if (en_passant_square == null) return;
@@ -588,7 +759,7 @@ void Board::generate_en_passant(MoveList &moves)
     int ep_file = en_passant_square % NUM_FILES;
 
     // check if there are enemy pawns in the same rank and neighboring files as the pawn that just double pushed
-    u64 attacker_pawns = rank_masks[rank_5 - 1 * side_to_move] & file_neighbor_masks[ep_file] & piece_occupancies[side_to_move][pawn];
+    u64 attacker_pawns = rank_masks[rank_5 - 1 * side] & file_neighbor_masks[ep_file] & piece_occupancies[side][pawn];
 
     // add all possible en passant moves
     while (attacker_pawns > 0)
@@ -606,13 +777,20 @@ void Board::generate_en_passant(MoveList &moves)
 
 void Board::generate_castles(MoveList &moves)
 {
-    bool king_castle_right = king_castle_ability[side_to_move];
-    bool queen_castle_right = queen_castle_ability[side_to_move];
+    if (side_to_move == WHITE) generate_castles<WHITE>(moves);
+    else generate_castles<BLACK>(moves);
+}
+
+template<Color side>
+void Board::generate_castles(MoveList &moves)
+{
+    bool king_castle_right = king_castle_ability[side];
+    bool queen_castle_right = queen_castle_ability[side];
     u64 full_occupancy = side_occupancy[WHITE] | side_occupancy[BLACK];
-    int side_offset = 56 * side_to_move;
+    constexpr int side_offset = 56 * side;
 
     // if king is in check, don't generate castles
-    if (in_check(side_to_move)) return;
+    if (in_check(side)) return;
 
     // handle king-side castle
     if (king_castle_right)
@@ -620,7 +798,7 @@ void Board::generate_castles(MoveList &moves)
         u64 king_side_castle_squares = 6ULL << side_offset;
 
         // only allow castle if pieces don't occupy king's path and king's path is not attacked
-        if ( (full_occupancy & king_side_castle_squares) == 0 && !side_attacked_on_square(side_to_move, static_cast<Square>(f1 + side_offset)) && !side_attacked_on_square(side_to_move, static_cast<Square>(g1 + side_offset)) )
+        if ( (full_occupancy & king_side_castle_squares) == 0 && !side_attacked_on_square(side, static_cast<Square>(f1 + side_offset)) && !side_attacked_on_square(side, static_cast<Square>(g1 + side_offset)) )
         {
             Square from_square = static_cast<Square>(e1 + side_offset);
             Square to_square = static_cast<Square>(g1 + side_offset);
@@ -634,7 +812,7 @@ void Board::generate_castles(MoveList &moves)
     {
         u64 queen_side_castle_squares = 112ULL << side_offset;
 
-        if ((full_occupancy & queen_side_castle_squares) == 0 && !side_attacked_on_square(side_to_move, static_cast<Square>(d1 + side_offset)) && !side_attacked_on_square(side_to_move, static_cast<Square>(c1 + side_offset)))
+        if ((full_occupancy & queen_side_castle_squares) == 0 && !side_attacked_on_square(side, static_cast<Square>(d1 + side_offset)) && !side_attacked_on_square(side, static_cast<Square>(c1 + side_offset)))
         {
             Square from_square = static_cast<Square>(e1 + side_offset);
             Square to_square = static_cast<Square>(c1 + side_offset);
@@ -646,13 +824,131 @@ void Board::generate_castles(MoveList &moves)
 
 void Board::generate_pseudo_legal_moves(MoveList &moves)
 {
-    generate_normal_moves(moves);
-    generate_en_passant(moves);
-    generate_castles(moves);
+    if (side_to_move == WHITE) generate_pseudo_legal_moves<WHITE>(moves);
+    else generate_pseudo_legal_moves<BLACK>(moves);
+}
+
+template<Color side>
+void Board::generate_pseudo_legal_moves(MoveList &moves)
+{
+    generate_pawn_moves<side>(moves);
+    generate_knight_moves(moves);
+    generate_bishop_moves(moves);
+    generate_rook_moves(moves);
+    generate_queen_moves(moves);
+    generate_king_moves(moves);
+    generate_en_passant<side>(moves);
+    generate_castles<side>(moves);
+}
+
+void Board::generate_legal_moves(MoveList &moves)
+{
+    MoveList pseudo_legal_moves;
+    Color side = side_to_move;
+    generate_pseudo_legal_moves(pseudo_legal_moves);
+
+    // keep moves that don't leave our own king in check
+    for (int i = 0; i < pseudo_legal_moves.count; i++)
+    {
+        Move m = pseudo_legal_moves.moves[i];
+
+        PreviousState state = make_move(m);
+        if (!in_check(side)) moves.add(m);
+        unmake_move(m, state);
+    }
+}
+
+bool Board::is_pseudo_legal(Move move)
+{
+    if (move.from == null || move.to == null || move.from == move.to) return false;
+
+    // extract info from move
+    Color side = side_to_move;
+    Color enemy_color = side == WHITE ? BLACK : WHITE;
+    Square from_square = move.from;
+    Square to_square = move.to;
+    MoveType move_type = move.move_type;
+    u64 from_mask = 1ULL << from_square;
+    u64 to_mask = 1ULL << to_square;
+    u64 full_occupancy = side_occupancy[WHITE] | side_occupancy[BLACK];
+
+    // offsets
+    int side_offset = 56 * side;
+    int push_offset = 8 * (1 - 2 * side);
+
+    // the mover has to be ours; captures need an enemy piece on the target, everything else an empty one
+    Piece from_piece = piece_at_square_for_side(from_square, side);
+    if (from_piece == none) return false;
+
+    bool capture = move_type == CAPTURE || move_type >= KNIGHT_PROMOTION_CAPTURE;
+    if (capture && (to_mask & side_occupancy[enemy_color]) == 0) return false;
+    if (!capture && (to_mask & full_occupancy) != 0) return false;
+
+    // castles: same conditions generate_castles checks
+    if (move_type == KING_CASTLE || move_type == QUEEN_CASTLE)
+    {
+        if (from_piece != king || from_square != e1 + side_offset) return false;
+
+        if (move_type == KING_CASTLE)
+        {
+            if (!king_castle_ability[side] || to_square != g1 + side_offset || (full_occupancy & (6ULL << side_offset)) != 0) return false;
+            return !in_check(side) && !side_attacked_on_square(side, static_cast<Square>(f1 + side_offset)) && !side_attacked_on_square(side, static_cast<Square>(g1 + side_offset));
+        }
+
+        if (!queen_castle_ability[side] || to_square != c1 + side_offset || (full_occupancy & (112ULL << side_offset)) != 0) return false;
+        return !in_check(side) && !side_attacked_on_square(side, static_cast<Square>(d1 + side_offset)) && !side_attacked_on_square(side, static_cast<Square>(c1 + side_offset));
+    }
+
+    // pawn moves: promotions exactly when the pawn stands on its 7th rank
+    if (from_piece == pawn)
+    {
+        bool promoting = (from_mask & rank_masks[rank_7 - 5 * side]) != 0;
+        if (promoting != (move_type >= KNIGHT_PROMOTION)) return false;
+
+        switch (move_type)
+        {
+            case QUIET:
+            case KNIGHT_PROMOTION:
+            case BISHOP_PROMOTION:
+            case ROOK_PROMOTION:
+            case QUEEN_PROMOTION:
+                return to_square == from_square + push_offset;
+            case DOUBLE_PAWN_PUSH:
+                return (from_mask & rank_masks[rank_2 + 5 * side]) != 0 && to_square == from_square + 2 * push_offset && (full_occupancy & (1ULL << (from_square + push_offset))) == 0;
+            case EN_PASSANT_CAPTURE:
+                return en_passant_square != null && to_square == en_passant_square && (pawn_attacks[side][from_square] & to_mask) != 0;
+            default:
+                return (pawn_attacks[side][from_square] & to_mask) != 0;
+        }
+    }
+
+    // pieces only make plain moves and captures
+    if (move_type != QUIET && move_type != CAPTURE) return false;
+    return (get_move_mask(from_piece, from_square, full_occupancy, side, move_type) & to_mask) != 0;
+}
+
+bool Board::is_legal(Move move)
+{
+    if (!is_pseudo_legal(move)) return false;
+
+    // make sure the move doesn't leave our own king in check
+    Color side = side_to_move;
+    PreviousState state = make_move(move);
+    bool legal = !in_check(side);
+    unmake_move(move, state);
+
+    return legal;
 }
 
 /* MAKING/UN-MAKING MOVES */
 PreviousState Board::make_move(Move move)
+{
+    if (side_to_move == WHITE) return make_move<WHITE>(move);
+    return make_move<BLACK>(move);
+}
+
+template<Color side>
+PreviousState Board::make_move(Move move)
 {
     // save prev state
     PreviousState prev_state;
@@ -664,18 +960,22 @@ PreviousState Board::make_move(Move move)
     prev_state.queen_castle_ability[BLACK] = queen_castle_ability[BLACK];
     prev_state.old_hash = hash;
 
+    // open a new accumulator for the child position
+    if (nnue != nullptr) nnue->push();
+
     // extract info from move
     Square from_square = move.from;
     Square to_square = move.to;
     MoveType move_type = move.move_type;
-    Color enemy_color = static_cast<Color>(1-side_to_move);
+    constexpr Color enemy_color = side == WHITE ? BLACK : WHITE;
 
     // offsets
-    int side_offset = 56 * side_to_move;
-    int en_passant_offset = 8 * (2 * side_to_move - 1);
+    constexpr int side_offset = 56 * side;
+    constexpr int enemy_offset = 56 * enemy_color;
+    constexpr int en_passant_offset = 8 * (2 * side - 1);
 
     // extract attacking and captured piece, if any; apply capture
-    Piece from_piece = piece_at_square_for_side(from_square, side_to_move);
+    Piece from_piece = piece_at_square_for_side(from_square, side);
     Piece to_piece = none;
     if (move_type == CAPTURE || move_type >= KNIGHT_PROMOTION_CAPTURE)
     {
@@ -686,8 +986,8 @@ PreviousState Board::make_move(Move move)
 
         if (move_type == CAPTURE) 
         {
-            recalibrate_occupancies(side_to_move, from_piece, to_square);
-            hash ^= piece_zobrists[side_to_move][from_piece][to_square];
+            recalibrate_occupancies(side, from_piece, to_square);
+            hash ^= piece_zobrists[side][from_piece][to_square];
         }
     }
     prev_state.moving_piece = from_piece;
@@ -701,15 +1001,15 @@ PreviousState Board::make_move(Move move)
     }
 
     // remove moving piece from its starting square
-    recalibrate_occupancies(side_to_move, from_piece, from_square);
-    hash ^= piece_zobrists[side_to_move][from_piece][from_square];
+    recalibrate_occupancies(side, from_piece, from_square);
+    hash ^= piece_zobrists[side][from_piece][from_square];
 
     // apply move normally if its not a promotion
     if (move_type < KNIGHT_PROMOTION && move_type != CAPTURE)
     {
         // add moving piece to its destination square
-        recalibrate_occupancies(side_to_move, from_piece, to_square);
-        hash ^= piece_zobrists[side_to_move][from_piece][to_square];
+        recalibrate_occupancies(side, from_piece, to_square);
+        hash ^= piece_zobrists[side][from_piece][to_square];
 
         // deal with all the other fun stuff 
         if (move_type > QUIET)
@@ -719,19 +1019,19 @@ PreviousState Board::make_move(Move move)
             else if (move_type == KING_CASTLE)
             {
                 // move king side rook
-                recalibrate_occupancies(side_to_move, rook, static_cast<Square>(h1 + side_offset));
-                recalibrate_occupancies(side_to_move, rook, static_cast<Square>(f1 + side_offset));
-                hash ^= piece_zobrists[side_to_move][rook][h1 + side_offset];
-                hash ^= piece_zobrists[side_to_move][rook][f1 + side_offset];
+                recalibrate_occupancies(side, rook, static_cast<Square>(h1 + side_offset));
+                recalibrate_occupancies(side, rook, static_cast<Square>(f1 + side_offset));
+                hash ^= piece_zobrists[side][rook][h1 + side_offset];
+                hash ^= piece_zobrists[side][rook][f1 + side_offset];
             }
 
             else if (move_type == QUEEN_CASTLE)
             {
                 // move queen side rook
-                recalibrate_occupancies(side_to_move, rook, static_cast<Square>(a1 + side_offset));
-                recalibrate_occupancies(side_to_move, rook, static_cast<Square>(d1 + side_offset));
-                hash ^= piece_zobrists[side_to_move][rook][a1 + side_offset];
-                hash ^= piece_zobrists[side_to_move][rook][d1 + side_offset];
+                recalibrate_occupancies(side, rook, static_cast<Square>(a1 + side_offset));
+                recalibrate_occupancies(side, rook, static_cast<Square>(d1 + side_offset));
+                hash ^= piece_zobrists[side][rook][a1 + side_offset];
+                hash ^= piece_zobrists[side][rook][d1 + side_offset];
             }
 
             else if (move_type == EN_PASSANT_CAPTURE) 
@@ -746,47 +1046,47 @@ PreviousState Board::make_move(Move move)
         // add promo piece
         if (move_type >= KNIGHT_PROMOTION_CAPTURE) 
         {
-            recalibrate_occupancies(side_to_move, static_cast<Piece>(move_type-KNIGHT_PROMOTION_CAPTURE + 1), to_square);
-            hash ^= piece_zobrists[side_to_move][move_type-KNIGHT_PROMOTION_CAPTURE + 1][to_square];
+            recalibrate_occupancies(side, static_cast<Piece>(move_type-KNIGHT_PROMOTION_CAPTURE + 1), to_square);
+            hash ^= piece_zobrists[side][move_type-KNIGHT_PROMOTION_CAPTURE + 1][to_square];
         }
         else 
         {
-            recalibrate_occupancies(side_to_move, static_cast<Piece>(move_type-KNIGHT_PROMOTION + 1), to_square);
-            hash ^= piece_zobrists[side_to_move][move_type-KNIGHT_PROMOTION + 1][to_square];
+            recalibrate_occupancies(side, static_cast<Piece>(move_type-KNIGHT_PROMOTION + 1), to_square);
+            hash ^= piece_zobrists[side][move_type-KNIGHT_PROMOTION + 1][to_square];
         }
     }
 
     // update castling rights
     if (from_piece == king || move_type == KING_CASTLE || move_type == QUEEN_CASTLE)
     {
-        if (king_castle_ability[side_to_move])
+        if (king_castle_ability[side])
         {
-            king_castle_ability[side_to_move] = false;
-            hash ^= king_castle_zobrists[side_to_move];
+            king_castle_ability[side] = false;
+            hash ^= king_castle_zobrists[side];
         }
-        if (queen_castle_ability[side_to_move])
+        if (queen_castle_ability[side])
         {
-            queen_castle_ability[side_to_move] = false;
-            hash ^= queen_castle_zobrists[side_to_move];
+            queen_castle_ability[side] = false;
+            hash ^= queen_castle_zobrists[side];
         }
     }
-    else if (from_piece == rook && from_square == (h1 + side_offset) && king_castle_ability[side_to_move]) 
+    else if (from_piece == rook && from_square == (h1 + side_offset) && king_castle_ability[side]) 
     {
-        king_castle_ability[side_to_move] = false;
-        hash ^= king_castle_zobrists[side_to_move];
+        king_castle_ability[side] = false;
+        hash ^= king_castle_zobrists[side];
     }
-    else if (from_piece == rook && from_square == (a1 + side_offset) && queen_castle_ability[side_to_move]) 
+    else if (from_piece == rook && from_square == (a1 + side_offset) && queen_castle_ability[side]) 
     {
-        queen_castle_ability[side_to_move] = false;
-        hash ^= queen_castle_zobrists[side_to_move];
+        queen_castle_ability[side] = false;
+        hash ^= queen_castle_zobrists[side];
     }
 
-    if (to_piece == rook && to_square == (h1 + 56 * enemy_color) && king_castle_ability[enemy_color]) 
+    if (to_piece == rook && to_square == (h1 + enemy_offset) && king_castle_ability[enemy_color]) 
     {
         king_castle_ability[enemy_color] = false;
         hash ^= king_castle_zobrists[enemy_color];
     }
-    else if (to_piece == rook && to_square == (a1 + 56 * enemy_color) && queen_castle_ability[enemy_color]) 
+    else if (to_piece == rook && to_square == (a1 + enemy_offset) && queen_castle_ability[enemy_color]) 
     {
         queen_castle_ability[enemy_color] = false;
         hash ^= queen_castle_zobrists[enemy_color];
@@ -797,7 +1097,7 @@ PreviousState Board::make_move(Move move)
     if (from_piece == pawn || move_type >= CAPTURE) half_moves = 0;
 
     // update full moves
-    if (side_to_move == BLACK) full_moves++;
+    if (side == BLACK) full_moves++;
 
     // update side-to-move
     side_to_move = enemy_color;
@@ -812,6 +1112,13 @@ PreviousState Board::make_move(Move move)
     return prev_state;
 }
 
+void Board::unmake_move(Move move, PreviousState prev_state)
+{
+    if (side_to_move == BLACK) unmake_move<WHITE>(move, prev_state);
+    else unmake_move<BLACK>(move, prev_state);
+}
+
+template<Color side>
 void Board::unmake_move(Move move, PreviousState prev_state)
 {
     // load prev state
@@ -823,22 +1130,27 @@ void Board::unmake_move(Move move, PreviousState prev_state)
     queen_castle_ability[BLACK] = prev_state.queen_castle_ability[BLACK];
     hash = prev_state.old_hash;
 
+    // the parent's accumulator is still intact, so the child's is simply dropped instead of recording the undo
+    NNUEStack* attached_nnue = nnue;
+    nnue = nullptr;
+
     // extract info from move
     Square from_square = move.from;
     Square to_square = move.to;
     MoveType move_type = move.move_type;
-    Color move_color = static_cast<Color>(1-side_to_move);
+    constexpr Color move_color = side;
+    constexpr Color enemy_color = side == WHITE ? BLACK : WHITE;
 
     // offsets
-    int side_offset = 56 * move_color;
-    int en_passant_offset = 8 * (2 * move_color - 1);
+    constexpr int side_offset = 56 * move_color;
+    constexpr int en_passant_offset = 8 * (2 * move_color - 1);
 
     // extract attacking and captured piece, if any; apply capture
     Piece moving_piece = prev_state.moving_piece;
     Piece taken_piece = prev_state.piece_captured;
     if (move_type == CAPTURE || move_type >= KNIGHT_PROMOTION_CAPTURE)
     {
-        recalibrate_occupancies(side_to_move, taken_piece, to_square);
+        recalibrate_occupancies(enemy_color, taken_piece, to_square);
         if (move_type == CAPTURE) 
         {
             recalibrate_occupancies(move_color, moving_piece, to_square);
@@ -873,7 +1185,7 @@ void Board::unmake_move(Move move, PreviousState prev_state)
 
             else if (move_type == EN_PASSANT_CAPTURE) 
             {
-                recalibrate_occupancies(side_to_move, pawn, static_cast<Square>(to_square + en_passant_offset));
+                recalibrate_occupancies(enemy_color, pawn, static_cast<Square>(to_square + en_passant_offset));
             }
         }
     }
@@ -894,10 +1206,82 @@ void Board::unmake_move(Move move, PreviousState prev_state)
     side_to_move = move_color;
 
     // update full moves
-    if (side_to_move == BLACK) full_moves--;
+    if (side == BLACK) full_moves--;
 
    // update hash history
     hash_history_index--;
+
+    nnue = attached_nnue;
+    if (nnue != nullptr) nnue->pop();
+}
+
+// side-templated versions are usable from other translation units
+template void Board::generate_pawn_moves<WHITE>(MoveList &moves);
+template void Board::generate_pawn_moves<BLACK>(MoveList &moves);
+template void Board::generate_en_passant<WHITE>(MoveList &moves);
+template void Board::generate_en_passant<BLACK>(MoveList &moves);
+template void Board::generate_castles<WHITE>(MoveList &moves);
+template void Board::generate_castles<BLACK>(MoveList &moves);
+template void Board::generate_pseudo_legal_moves<WHITE>(MoveList &moves);
+template void Board::generate_pseudo_legal_moves<BLACK>(MoveList &moves);
+template PreviousState Board::make_move<WHITE>(Move move);
+template PreviousState Board::make_move<BLACK>(Move move);
+template void Board::unmake_move<WHITE>(Move move, PreviousState prev_state);
+template void Board::unmake_move<BLACK>(Move move, PreviousState prev_state);
+
+// hash the position would have after the move, without making it; mirrors make_move's zobrist updates
+u64 Board::key_after(Move move)
+{
+    // extract info from move
+    Color side = side_to_move;
+    Color enemy_color = side == WHITE ? BLACK : WHITE;
+    Square from_square = move.from;
+    Square to_square = move.to;
+    MoveType move_type = move.move_type;
+
+    // offsets
+    int side_offset = 56 * side;
+    int enemy_offset = 56 * enemy_color;
+    int en_passant_offset = 8 * (2 * side - 1);
+
+    // side to move flips and any en passant square goes away
+    u64 key = hash ^ side_zobrist;
+    if (en_passant_square != null) key ^= en_passant_zobrists[en_passant_square % NUM_FILES];
+
+    // captured piece leaves its square
+    Piece from_piece = piece_at_square_for_side(from_square, side);
+    Piece to_piece = none;
+    if (move_type == CAPTURE || move_type >= KNIGHT_PROMOTION_CAPTURE)
+    {
+        to_piece = piece_at_square_for_side(to_square, enemy_color);
+        key ^= piece_zobrists[enemy_color][to_piece][to_square];
+    }
+
+    // moving piece, or the piece it promotes to, moves from its starting square to its destination
+    key ^= piece_zobrists[side][from_piece][from_square];
+    if (move_type >= KNIGHT_PROMOTION_CAPTURE) key ^= piece_zobrists[side][move_type-KNIGHT_PROMOTION_CAPTURE + 1][to_square];
+    else if (move_type >= KNIGHT_PROMOTION) key ^= piece_zobrists[side][move_type-KNIGHT_PROMOTION + 1][to_square];
+    else key ^= piece_zobrists[side][from_piece][to_square];
+
+    // special moves
+    if (move_type == DOUBLE_PAWN_PUSH) key ^= en_passant_zobrists[(to_square + en_passant_offset) % NUM_FILES];
+    else if (move_type == KING_CASTLE) key ^= piece_zobrists[side][rook][h1 + side_offset] ^ piece_zobrists[side][rook][f1 + side_offset];
+    else if (move_type == QUEEN_CASTLE) key ^= piece_zobrists[side][rook][a1 + side_offset] ^ piece_zobrists[side][rook][d1 + side_offset];
+    else if (move_type == EN_PASSANT_CAPTURE) key ^= piece_zobrists[enemy_color][pawn][to_square + en_passant_offset];
+
+    // castling rights lost by this move
+    if (from_piece == king)
+    {
+        if (king_castle_ability[side]) key ^= king_castle_zobrists[side];
+        if (queen_castle_ability[side]) key ^= queen_castle_zobrists[side];
+    }
+    else if (from_piece == rook && from_square == (h1 + side_offset) && king_castle_ability[side]) key ^= king_castle_zobrists[side];
+    else if (from_piece == rook && from_square == (a1 + side_offset) && queen_castle_ability[side]) key ^= queen_castle_zobrists[side];
+
+    if (to_piece == rook && to_square == (h1 + enemy_offset) && king_castle_ability[enemy_color]) key ^= king_castle_zobrists[enemy_color];
+    else if (to_piece == rook && to_square == (a1 + enemy_offset) && queen_castle_ability[enemy_color]) key ^= queen_castle_zobrists[enemy_color];
+
+    return key;
 }
 
 bool Board::is_50_move_draw()
@@ -926,26 +1310,9 @@ bool Board::is_insufficient_material()
 int Board::num_legal_moves()
 {
     MoveList moves;
-    Color side = side_to_move;
-    int legal_moves = 0;
-    generate_pseudo_legal_moves(moves);
-
-    for (int i = 0; i < moves.count; i++)
-    {
-        Move m = moves.moves[i];
-
-        PreviousState state = make_move(m);
-        if (in_check(side))
-        {
-            unmake_move(m, state);
-            continue;
-        }
-
-        unmake_move(m, state);
-        legal_moves++;
-    }
+    generate_legal_moves(moves);
 
-    return legal_moves;
+    return moves.count;
 }
 
 bool Board::is_drawn()
@@ -1411,6 +1778,9 @@ void setup()
     generate_magics(rook);
     generate_zobrists();
 
+    // endgame bitbases
+    generate_kpk_bitbase();
+
     // opening book setup
     Board::pgn_to_opening_book("pgns/Belgrade2022-GP2.pgn");
     Board::pgn_to_opening_book("pgns/Berlin2022-GP1.pgn");
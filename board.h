@@ -6,6 +6,20 @@
 #include <unordered_map>
 using namespace std;
 
+// per-ply network accumulators a search can attach to the board (see nnue.h)
+class NNUEStack;
+
+// immutable eval weights the running scores are taken from (see evaluate.h)
+struct EvalWeights;
+
+// squares attacked by each piece on the board, built once with Board::compute_attacks and shared by eval, exchange and check tests
+typedef struct AttackInfo {
+    // attacks of the piece standing on each square; only meaningful for occupied squares
+    u64 piece_attacks[NUM_SQUARES];
+    u64 by_piece[NUM_COLORS][NUM_PIECES];
+    u64 by_side[NUM_COLORS];
+} AttackInfo;
+
 class Board
 {
     private:
@@ -23,9 +37,22 @@ class Board
         u64 hash;
         u64 hash_history[MAX_HASH_HISTORY];
         int hash_history_index;
+        u64 pawn_hash;
+
+        // running material + piece-square scores from white's side under the attached weights, kept up to date by recalibrate_occupancies
+        const EvalWeights* weights;
+        int mg_score;
+        int eg_score;
+        int phase;
+
+        // attached accumulator stack, if the search evaluates with the network; not owned
+        NNUEStack* nnue;
 
         // opening book
         static unordered_map<u64, vector<Move>> opening_book;
+
+        // rebuild occupancies, scores and hashes once the pieces and flags are in place
+        void reset_state();
     public:   
         // constructors
         Board();
@@ -35,23 +62,35 @@ class Board
         Color get_side_to_move();
         u64 get_piece_occupancy(Color side, Piece piece);
         u64 get_hash();
+        u64 get_pawn_hash();
+        Square get_en_passant_square();
+        bool has_castling_rights();
+        int get_mg_score();
+        int get_eg_score();
+        int get_phase();
+        void set_nnue(NNUEStack* stack);
+        void set_eval_weights(const EvalWeights* new_weights);
 
         void calibrate_occupancies();
         void recalibrate_occupancies(Color side, Piece piece, Square sq);
+        void calibrate_scores();
 
         Piece piece_at_square_for_side(Square sq, Color side);
         u64 get_move_mask(Piece piece, Square from_square, u64 full_occupancy, Color side, MoveType type);
 
         bool side_attacked_on_square(Color side, Square sq);
         bool in_check(Color side);
+        bool in_check(Color side, AttackInfo& attacks);
+        void compute_attacks(AttackInfo& attacks);
 
         /* METHODS FOR MOVE GENERATION */
 
         // helper methods for extracting moves from bitboard masks
         void add_moves(MoveList &moves, Square from_square, u64 to_squares_bitboard, MoveType type);
 
-        // normal moves
+        // normal moves (side-templated generators avoid per-call side arithmetic; the untemplated ones branch once)
         void generate_pawn_moves(MoveList &moves);
+        template<Color side> void generate_pawn_moves(MoveList &moves);
         void generate_knight_moves(MoveList &moves);
         void generate_bishop_moves(MoveList &moves);
         void generate_rook_moves(MoveList &moves);
@@ -62,13 +101,24 @@ class Board
         // special moves (en passant, castling)
         void generate_en_passant(MoveList &moves);
         void generate_castles(MoveList &moves);
+        template<Color side> void generate_en_passant(MoveList &moves);
+        template<Color side> void generate_castles(MoveList &moves);
 
         // generate all moves
         void generate_pseudo_legal_moves(MoveList &moves);
+        template<Color side> void generate_pseudo_legal_moves(MoveList &moves);
+        void generate_legal_moves(MoveList &moves);
+
+        // check a single move, e.g. one from the hash table, without generating the move list
+        bool is_pseudo_legal(Move move);
+        bool is_legal(Move move);
 
         // make/un-make moves
         PreviousState make_move(Move move);
         void unmake_move(Move move, PreviousState prev_state);
+        template<Color side> PreviousState make_move(Move move);
+        template<Color side> void unmake_move(Move move, PreviousState prev_state);
+        u64 key_after(Move move);
 
         // draw stuff for search
         bool is_50_move_draw();
@@ -86,6 +136,7 @@ class Board
 
         // fen stuff + displaying board
         void from_fen(string fen);
+        void set_position(u64 occupancies[NUM_COLORS][NUM_PIECES], Color side);
         string to_fen();
         void print(); 
 
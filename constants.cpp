@@ -267,6 +267,30 @@ void generate_zobrists()
     }
 }
 
+u64 zobrist_fingerprint()
+{
+    // fold each key into the digest with a rotate so that order matters
+    u64 fingerprint = 0ULL;
+    auto fold = [&fingerprint](u64 key) { fingerprint = ((fingerprint << 7) | (fingerprint >> 57)) ^ key; };
+
+    for (int i = 0; i < NUM_COLORS; i++)
+    {
+        for (int j = 0; j < NUM_PIECES; j++)
+        {
+            for (int k = 0; k < NUM_SQUARES; k++) fold(piece_zobrists[i][j][k]);
+        }
+    }
+    fold(side_zobrist);
+    for (int i = 0; i < NUM_COLORS; i++)
+    {
+        fold(king_castle_zobrists[i]);
+        fold(queen_castle_zobrists[i]);
+    }
+    for (int i = 0; i < NUM_FILES; i++) fold(en_passant_zobrists[i]);
+
+    return fingerprint;
+}
+
 u64 rng()
 {
     seed ^= (seed << 13);
@@ -17,7 +17,28 @@ using namespace std;
 #define MAX_MOVES 256
 #define MAX_HASH_HISTORY 1024
 #define OPENING_BOOK_MOVES 12
-#define TT_ENTRIES 1048576 // about 32 MB
+#define DEFAULT_TT_MB 32
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE 2097152 // 2 MB
+#define TT_CLUSTER_SIZE 8 // entries per cache line
+#define TT_FILE_VERSION 1
+#define MAX_MULTI_PV 16
+#define MAX_PLY 128
+#define TOTAL_PHASE 24 // knights and bishops 1, rooks 2, queens 4
+#define PAWN_TABLE_ENTRIES 16384
+#define EVAL_TABLE_ENTRIES 65536
+#define DEFAULT_LAZY_MARGIN 400 // centipawns the positional terms are assumed never to swing
+#define KPK_POSITIONS 196608 // 24 pawn squares x 64 x 64 king squares x 2 sides to move
+#define KNOWN_WIN_BONUS 1000 // added for the winning side of an ending the bitbase has decided
+#define TB_MAX_PIECES 4 // kings included
+#define TB_FILE_VERSION 1
+#define NNUE_INPUTS 768 // 2 colors x 6 pieces x 64 squares
+#define NNUE_HIDDEN 256
+#define NNUE_QA 255 // hidden activations are clamped to [0, NNUE_QA]
+#define NNUE_QB 64 // output weight quantization
+#define NNUE_SCALE 400 // output units to centipawns
+#define NNUE_FILE_VERSION 1
+#define NNUE_STACK_SIZE (2 * MAX_PLY) // search plies plus the captures quiescence can add
 
 #define MAX_BOUND 99999
 #define TIME_SCORE 999999
@@ -134,6 +155,9 @@ void generate_static_bitboards();
 // generate zobrists
 void generate_zobrists();
 
+// digest of every zobrist key, to tell whether stored hashes came from the same keys
+u64 zobrist_fingerprint();
+
 // function to generate random number
 u64 rng();
 
@@ -1,25 +1,453 @@
 #include "evaluate.h"
+#include "kpk.h"
 #include <iostream>
 
-// init params
-EvalParams Evaluate::params = {{100, 300, 300, 500, 900, 1000}};
+// piece-square tables (a8 first, h1 last)
+static const int default_mg_psqt[NUM_PIECES][NUM_SQUARES] = {
+    // pawn
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    // knight
+    {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50
+    },
+    // bishop
+    {
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20
+    },
+    // rook
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0
+    },
+    // queen
+    {
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20
+    },
+    // king
+    {
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20
+    }
+};
+
+static const int default_eg_psqt[NUM_PIECES][NUM_SQUARES] = {
+    // pawn
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         80,  80,  80,  80,  80,  80,  80,  80,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         30,  30,  30,  30,  30,  30,  30,  30,
+         15,  15,  15,  15,  15,  15,  15,  15,
+          5,   5,   5,   5,   5,   5,   5,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    // knight
+    {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50
+    },
+    // bishop
+    {
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20
+    },
+    // rook
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    // queen
+    {
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20
+    },
+    // king
+    {
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50
+    }
+};
+
+// game phase weights
+const int piece_phases[NUM_PIECES] = {0, 1, 1, 2, 4, 0};
+
+Evaluator::Evaluator()
+{
+    pawn_table = new PawnEntry[PAWN_TABLE_ENTRIES];
+    eval_table = new std::atomic<u64>[EVAL_TABLE_ENTRIES];
+    lazy_margin = DEFAULT_LAZY_MARGIN;
+    trace = nullptr;
+    set_weights(default_weights());
+}
+
+Evaluator::~Evaluator()
+{
+    delete[] pawn_table;
+    delete[] eval_table;
+}
+
+void Evaluator::set_weights(std::shared_ptr<const EvalWeights> new_weights)
+{
+    weights = new_weights;
+
+    // cached scores were computed with the old weights
+    clear_tables();
+}
+
+void Evaluator::clear_tables()
+{
+    for (int i = 0; i < PAWN_TABLE_ENTRIES; i++) pawn_table[i] = {0ULL, 0, 0};
+    for (int i = 0; i < EVAL_TABLE_ENTRIES; i++) eval_table[i].store(0ULL, std::memory_order_relaxed);
+}
 
-int Evaluate::eval(Board& board)
+int Evaluator::eval(Board& board)
 {
-    // basic static eval
-    int score = 0;
+    bool early_exit;
+    return eval(board, -MAX_BOUND, MAX_BOUND, early_exit);
+}
+
+int Evaluator::eval(Board& board, int alpha, int beta, bool& early_exit)
+{
+    // material and piece-square terms are kept up to date by the board as moves are made;
+    // blend them by phase, from all middlegame with every piece on the board to all endgame with none
+    int phase = min(board.get_phase(), TOTAL_PHASE);
+    int mg_score = board.get_mg_score();
+    int eg_score = board.get_eg_score();
+    int sign = board.get_side_to_move() == WHITE ? 1 : -1;
 
-    for (int j = 0; j < NUM_PIECES; j++)
+    // king and pawn against king is decided by the bitbase; drawn ones are dead, won ones get pushed well clear of them
+    // (not while tracing, so the tuner only ever sees terms that are linear in the params)
+    u64 pawns = board.get_piece_occupancy(WHITE, pawn) | board.get_piece_occupancy(BLACK, pawn);
+    if (board.get_phase() == 0 && pop_count(pawns) == 1 && trace == nullptr)
     {
-        u64 white_occ = board.get_piece_occupancy(WHITE, static_cast<Piece>(j));
-        u64 black_occ = board.get_piece_occupancy(BLACK, static_cast<Piece>(j));
-        score += (pop_count(white_occ) - pop_count(black_occ)) * params.piece_scores[j];
+        Color strong = board.get_piece_occupancy(WHITE, pawn) ? WHITE : BLACK;
+        Color weak = strong == WHITE ? BLACK : WHITE;
+        Square strong_king = static_cast<Square>(lsb(board.get_piece_occupancy(strong, king)));
+        Square weak_king = static_cast<Square>(lsb(board.get_piece_occupancy(weak, king)));
+        if (!probe_kpk(strong, strong_king, static_cast<Square>(lsb(pawns)), weak_king, board.get_side_to_move()))
+        {
+            early_exit = false;
+            return DRAW_SCORE;
+        }
+
+        int known_win = strong == WHITE ? KNOWN_WIN_BONUS : -KNOWN_WIN_BONUS;
+        mg_score += known_win;
+        eg_score += known_win;
     }
 
-    return score * (board.get_side_to_move() == WHITE ? 1 : -1);
+    // the rest of the eval can't bring a score this far outside the window back into it
+    int lazy_score = (eg_score + (mg_score - eg_score) * phase / TOTAL_PHASE) * sign;
+    early_exit = lazy_score + lazy_margin <= alpha || lazy_score - lazy_margin >= beta;
+    if (early_exit) return lazy_score;
+    if (trace != nullptr) trace_material(board);
+
+    eval_pawns(board, mg_score, eg_score);
+
+    // every piece's attacks are looked up once and shared by the mobility and king safety terms
+    AttackInfo attacks;
+    board.compute_attacks(attacks);
+    eval_pieces(board, attacks, mg_score, eg_score);
+
+    int score = eg_score + (mg_score - eg_score) * phase / TOTAL_PHASE;
+
+    return score * sign;
+}
+
+bool Evaluator::probe_eval(u64 key, int& score)
+{
+    u64 entry = eval_table[key & (EVAL_TABLE_ENTRIES - 1)].load(std::memory_order_relaxed);
+    if ((entry ^ key) >> 16 != 0) return false;
+
+    score = static_cast<short>(entry & 0xFFFF);
+    return true;
 }
 
-void Evaluate::update_params(EvalParams new_params)
+void Evaluator::store_eval(u64 key, int score)
 {
-    params = new_params;
+    eval_table[key & (EVAL_TABLE_ENTRIES - 1)].store((key & ~0xFFFFULL) | static_cast<u16>(score), std::memory_order_relaxed);
+}
+
+void Evaluator::trace_material(Board& board)
+{
+    // the board keeps these terms as running sums, so count them from the pieces; tables are drawn from a8
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        int sign = color == WHITE ? 1 : -1;
+        for (int piece = 0; piece < NUM_PIECES; piece++)
+        {
+            u64 occ = board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece));
+            while (occ > 0)
+            {
+                int sq = lsb(occ);
+                trace->piece_scores[piece] += sign;
+                trace->psqt[piece][63 - (color == WHITE ? sq : sq ^ 56)] += sign;
+                occ &= (occ - 1);
+            }
+        }
+    }
+}
+
+void Evaluator::eval_pawns(Board& board, int& mg_score, int& eg_score)
+{
+    // pawn structure only depends on where the pawns are, so it is cached on the pawn hash
+    u64 key = board.get_pawn_hash();
+    PawnEntry& entry = pawn_table[key & (PAWN_TABLE_ENTRIES - 1)];
+    if (entry.key != key || trace != nullptr)
+    {
+        entry = {key, 0, 0};
+        for (int color = 0; color < NUM_COLORS; color++)
+        {
+            int sign = color == WHITE ? 1 : -1;
+            u64 own_pawns = board.get_piece_occupancy(static_cast<Color>(color), pawn);
+            u64 enemy_pawns = board.get_piece_occupancy(static_cast<Color>(1 - color), pawn);
+
+            u64 pawns = own_pawns;
+            while (pawns > 0)
+            {
+                int sq = lsb(pawns);
+                int file = sq % NUM_FILES;
+                int rank = sq / NUM_FILES;
+                int relative_rank = color == WHITE ? rank : 7 - rank;
+
+                // squares on the ranks in front of this pawn, from its own side
+                u64 ahead = color == WHITE ? ~0ULL << (NUM_FILES * (rank + 1)) : (1ULL << (NUM_FILES * rank)) - 1;
+
+                // doubled: another of our pawns in front on the same file
+                if (file_masks[file] & ahead & own_pawns)
+                {
+                    entry.mg_score += sign * weights->params.mg_doubled_pawn;
+                    entry.eg_score += sign * weights->params.eg_doubled_pawn;
+                    if (trace != nullptr) trace->doubled_pawn += sign;
+                }
+
+                // isolated: no friendly pawns on the neighboring files;
+                // backward: none level or behind to support it either, and its stop square is covered by an enemy pawn
+                if ((file_neighbor_masks[file] & own_pawns) == 0)
+                {
+                    entry.mg_score += sign * weights->params.mg_isolated_pawn;
+                    entry.eg_score += sign * weights->params.eg_isolated_pawn;
+                    if (trace != nullptr) trace->isolated_pawn += sign;
+                }
+                else if ((file_neighbor_masks[file] & ~ahead & own_pawns) == 0 && (pawn_attacks[color][sq + (color == WHITE ? 8 : -8)] & enemy_pawns))
+                {
+                    entry.mg_score += sign * weights->params.mg_backward_pawn;
+                    entry.eg_score += sign * weights->params.eg_backward_pawn;
+                    if (trace != nullptr) trace->backward_pawn += sign;
+                }
+
+                // passed: no enemy pawns in front on this or the neighboring files
+                if (((file_masks[file] | file_neighbor_masks[file]) & ahead & enemy_pawns) == 0)
+                {
+                    entry.mg_score += sign * weights->params.mg_passed_pawn[relative_rank];
+                    entry.eg_score += sign * weights->params.eg_passed_pawn[relative_rank];
+                    if (trace != nullptr) trace->passed_pawn[relative_rank] += sign;
+                }
+
+                pawns &= (pawns - 1);
+            }
+        }
+    }
+
+    mg_score += entry.mg_score;
+    eg_score += entry.eg_score;
+}
+
+void Evaluator::eval_pieces(Board& board, AttackInfo& attacks, int& mg_score, int& eg_score)
+{
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        int sign = color == WHITE ? 1 : -1;
+        Color enemy = static_cast<Color>(1 - color);
+
+        // squares worth moving to, and the enemy king with the squares around it
+        u64 own_pieces = 0ULL;
+        for (int piece = 0; piece < NUM_PIECES; piece++) own_pieces |= board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece));
+        u64 mobility_area = ~own_pieces & ~attacks.by_piece[enemy][pawn];
+        int enemy_king = lsb(board.get_piece_occupancy(enemy, king));
+        u64 king_zone = king_attacks[enemy_king] | (1ULL << enemy_king);
+
+        int mg_king_danger = 0;
+        int eg_king_danger = 0;
+        int king_attackers = 0;
+        int zone_hits_by_piece[NUM_PIECES] = {};
+        for (int piece = knight; piece <= queen; piece++)
+        {
+            u64 occ = board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece));
+            while (occ > 0)
+            {
+                u64 piece_attack = attacks.piece_attacks[lsb(occ)];
+
+                int moves = pop_count(piece_attack & mobility_area);
+                mg_score += sign * weights->params.mg_mobility[piece] * moves;
+                eg_score += sign * weights->params.eg_mobility[piece] * moves;
+                if (trace != nullptr) trace->mobility[piece] += sign * moves;
+
+                int zone_hits = pop_count(piece_attack & king_zone);
+                if (zone_hits > 0)
+                {
+                    king_attackers++;
+                    mg_king_danger += weights->params.mg_king_attack[piece] * zone_hits;
+                    eg_king_danger += weights->params.eg_king_attack[piece] * zone_hits;
+                    zone_hits_by_piece[piece] += zone_hits;
+                }
+
+                occ &= (occ - 1);
+            }
+        }
+
+        // a lone attacker is rarely dangerous
+        if (king_attackers >= 2)
+        {
+            mg_score += sign * mg_king_danger;
+            eg_score += sign * eg_king_danger;
+            if (trace != nullptr) for (int piece = knight; piece <= queen; piece++) trace->king_attack[piece] += sign * zone_hits_by_piece[piece];
+        }
+    }
+}
+
+std::shared_ptr<const EvalWeights> Evaluator::make_weights(EvalParams params)
+{
+    std::shared_ptr<EvalWeights> new_weights = std::make_shared<EvalWeights>();
+    new_weights->params = params;
+
+    // fold material into the piece-square tables; tables are drawn from a8, and black reads them upside down
+    for (int piece = 0; piece < NUM_PIECES; piece++)
+    {
+        for (int sq = 0; sq < NUM_SQUARES; sq++)
+        {
+            new_weights->mg_psqt[WHITE][piece][sq] = params.mg_piece_scores[piece] + params.mg_psqt[piece][63 - sq];
+            new_weights->eg_psqt[WHITE][piece][sq] = params.eg_piece_scores[piece] + params.eg_psqt[piece][63 - sq];
+            new_weights->mg_psqt[BLACK][piece][sq] = -(params.mg_piece_scores[piece] + params.mg_psqt[piece][63 - (sq ^ 56)]);
+            new_weights->eg_psqt[BLACK][piece][sq] = -(params.eg_piece_scores[piece] + params.eg_psqt[piece][63 - (sq ^ 56)]);
+        }
+    }
+
+    return new_weights;
+}
+
+std::shared_ptr<const EvalWeights> Evaluator::default_weights()
+{
+    // built on first use and shared by every evaluator and board that doesn't ask for anything else
+    static const std::shared_ptr<const EvalWeights> shared_default = make_weights(default_params());
+    return shared_default;
+}
+
+EvalParams Evaluator::default_params()
+{
+    EvalParams default_params = {};
+    int mg_piece_scores[NUM_PIECES] = {100, 300, 300, 500, 900, 1000};
+    int eg_piece_scores[NUM_PIECES] = {120, 280, 300, 520, 920, 1000};
+    for (int piece = 0; piece < NUM_PIECES; piece++)
+    {
+        default_params.mg_piece_scores[piece] = mg_piece_scores[piece];
+        default_params.eg_piece_scores[piece] = eg_piece_scores[piece];
+        for (int sq = 0; sq < NUM_SQUARES; sq++)
+        {
+            default_params.mg_psqt[piece][sq] = default_mg_psqt[piece][sq];
+            default_params.eg_psqt[piece][sq] = default_eg_psqt[piece][sq];
+        }
+    }
+
+    // pawn structure
+    default_params.mg_doubled_pawn = -10;
+    default_params.eg_doubled_pawn = -20;
+    default_params.mg_isolated_pawn = -10;
+    default_params.eg_isolated_pawn = -15;
+    default_params.mg_backward_pawn = -8;
+    default_params.eg_backward_pawn = -10;
+    int mg_passed_pawn[NUM_RANKS] = {0, 5, 10, 15, 25, 40, 60, 0};
+    int eg_passed_pawn[NUM_RANKS] = {0, 10, 20, 35, 60, 100, 150, 0};
+    for (int rank = 0; rank < NUM_RANKS; rank++)
+    {
+        default_params.mg_passed_pawn[rank] = mg_passed_pawn[rank];
+        default_params.eg_passed_pawn[rank] = eg_passed_pawn[rank];
+    }
+
+    // mobility and king safety
+    int mg_mobility[NUM_PIECES] = {0, 4, 5, 2, 1, 0};
+    int eg_mobility[NUM_PIECES] = {0, 4, 5, 4, 2, 0};
+    int mg_king_attack[NUM_PIECES] = {0, 8, 8, 10, 15, 0};
+    int eg_king_attack[NUM_PIECES] = {0, 2, 2, 3, 5, 0};
+    for (int piece = 0; piece < NUM_PIECES; piece++)
+    {
+        default_params.mg_mobility[piece] = mg_mobility[piece];
+        default_params.eg_mobility[piece] = eg_mobility[piece];
+        default_params.mg_king_attack[piece] = mg_king_attack[piece];
+        default_params.eg_king_attack[piece] = eg_king_attack[piece];
+    }
+
+    return default_params;
 }
\ No newline at end of file
@@ -1,15 +1,110 @@
 #pragma once
 #include "board.h"
+#include <atomic>
+#include <memory>
 
 typedef struct EvalParams {
-    int piece_scores[NUM_PIECES];
+    int mg_piece_scores[NUM_PIECES];
+    int eg_piece_scores[NUM_PIECES];
+
+    // piece-square bonuses for white, laid out the way the board is drawn (a8 first, h1 last); black mirrors them
+    int mg_psqt[NUM_PIECES][NUM_SQUARES];
+    int eg_psqt[NUM_PIECES][NUM_SQUARES];
+
+    // pawn structure, per pawn; passed pawn bonuses are indexed by rank from the pawn's own side
+    int mg_doubled_pawn;
+    int eg_doubled_pawn;
+    int mg_isolated_pawn;
+    int eg_isolated_pawn;
+    int mg_backward_pawn;
+    int eg_backward_pawn;
+    int mg_passed_pawn[NUM_RANKS];
+    int eg_passed_pawn[NUM_RANKS];
+
+    // per square a piece can move to that isn't our own or covered by an enemy pawn
+    int mg_mobility[NUM_PIECES];
+    int eg_mobility[NUM_PIECES];
+
+    // per square of the enemy king's zone a piece attacks, counted once at least two pieces join the attack
+    int mg_king_attack[NUM_PIECES];
+    int eg_king_attack[NUM_PIECES];
 } EvalParams;
 
-class Evaluate
+// cached pawn structure score for one pawn hash, from white's side
+typedef struct PawnEntry {
+    u64 key;
+    int mg_score;
+    int eg_score;
+} PawnEntry;
+
+// how often each term fired in one eval, white's count minus black's; every count applies to both the mg and eg param of its term
+typedef struct EvalTrace {
+    int piece_scores[NUM_PIECES];
+    int psqt[NUM_PIECES][NUM_SQUARES];
+    int doubled_pawn;
+    int isolated_pawn;
+    int backward_pawn;
+    int passed_pawn[NUM_RANKS];
+    int mobility[NUM_PIECES];
+    int king_attack[NUM_PIECES];
+} EvalTrace;
+
+// how much each piece counts toward the game phase; all of them together make TOTAL_PHASE
+extern const int piece_phases[NUM_PIECES];
+
+// one set of params with material folded into signed piece-square tables; built once and never changed, so any number of evaluators and boards can share it
+typedef struct EvalWeights {
+    EvalParams params;
+
+    // material + piece-square value of each piece on each square, signed from white's side
+    int mg_psqt[NUM_COLORS][NUM_PIECES][NUM_SQUARES];
+    int eg_psqt[NUM_COLORS][NUM_PIECES][NUM_SQUARES];
+} EvalWeights;
+
+// evaluates with one set of weights; every search owns its own, so searches with different weights can run side by side
+class Evaluator
 {
     private:
-        static EvalParams params;
+        std::shared_ptr<const EvalWeights> weights;
+        PawnEntry* pawn_table;
+
+        // full evaluations by position hash, one word per entry: upper 48 hash bits above the 16-bit score;
+        // direct-mapped and read/written whole, so threads sharing an evaluator never see a torn entry
+        std::atomic<u64>* eval_table;
+
+        // how far outside the window the material + piece-square score must be to skip the positional terms
+        int lazy_margin;
+
+        // when set, full evals also count how often each term fired, bypassing the pawn table
+        EvalTrace* trace;
+
+        void clear_tables();
+        void trace_material(Board& board);
+        void eval_pawns(Board& board, int& mg_score, int& eg_score);
+        void eval_pieces(Board& board, AttackInfo& attacks, int& mg_score, int& eg_score);
     public:
-        static int eval(Board& board);
-        static void update_params(EvalParams new_params);
+        Evaluator();
+        ~Evaluator();
+        Evaluator(const Evaluator&) = delete;
+        Evaluator& operator=(const Evaluator&) = delete;
+
+        // weights
+        const EvalWeights* get_weights() { return weights.get(); }
+        void set_weights(std::shared_ptr<const EvalWeights> new_weights);
+        void set_lazy_margin(int margin) { lazy_margin = margin; }
+        void set_trace(EvalTrace* new_trace) { trace = new_trace; }
+
+        int eval(Board& board);
+
+        // staged eval: returns the material + piece-square score alone if it is already lazy_margin outside [alpha, beta]
+        int eval(Board& board, int alpha, int beta, bool& early_exit);
+
+        // eval cache
+        bool probe_eval(u64 key, int& score);
+        void store_eval(u64 key, int score);
+
+        // weight blocks
+        static std::shared_ptr<const EvalWeights> make_weights(EvalParams params);
+        static std::shared_ptr<const EvalWeights> default_weights();
+        static EvalParams default_params();
 };
\ No newline at end of file
@@ -1,7 +1,7 @@
 #include "gauntlet.h"
 #include <iostream>
 
-pair<int, int> Gauntlet::fight(Search* ai_one, Search* ai_two, EvalParams eval_one, EvalParams eval_two, int rounds, int ms_per_move)
+pair<int, int> Gauntlet::fight(Search* ai_one, Search* ai_two, int rounds, int ms_per_move)
 {   
     // record number of times ai_one wins/draws
     int ai_one_wins = 0;
@@ -13,7 +13,6 @@ pair<int, int> Gauntlet::fight(Search* ai_one, Search* ai_two, EvalParams eval_o
     
     // performm multiple rounds
     Search* ais[2] = {ai_one, ai_two};
-    EvalParams params[2] = {eval_one, eval_two};
     int turn = 0;
     Board board;
     for (int i = 0; i < rounds; i++)
@@ -21,14 +20,15 @@ pair<int, int> Gauntlet::fight(Search* ai_one, Search* ai_two, EvalParams eval_o
         // switch colors
         turn = i % 2;
 
-        // reset board
+        // reset board, and anything the ai's kept from the last game
         board.from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+        ai_one->new_game();
+        ai_two->new_game();
 
         // play a game
         while (true)
         {
-            // get move
-            Evaluate::update_params(params[turn]);
+            // get move; each ai evaluates with its own weights
             Move move = Board::get_book_move(board.get_hash());
             if (move.from == null) move = ais[turn]->deepening_search(board);
 
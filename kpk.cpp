@@ -0,0 +1,157 @@
+#include "kpk.h"
+#include "bitboard.h"
+#include <vector>
+using namespace std;
+
+// define bitbase
+u64 kpk_bitbase[KPK_POSITIONS / 64];
+
+// per-position state while generating; unknown positions still left at the end are draws
+typedef enum KPKResult {
+    KPK_INVALID,
+    KPK_UNKNOWN,
+    KPK_DRAW,
+    KPK_WIN
+} KPKResult;
+
+// pawn squares are a2-d7 (files d..a are file indices 4..7 here), so 4 files x 6 ranks
+static int kpk_index(int strong_king, int weak_king, int pawn_sq, int side_to_move)
+{
+    int pawn_index = (pawn_sq / NUM_FILES - 1) * 4 + (pawn_sq % NUM_FILES - 4);
+    return side_to_move + 2 * (weak_king + NUM_SQUARES * (strong_king + NUM_SQUARES * pawn_index));
+}
+
+// results that follow from the position alone, before any search
+static KPKResult classify(int strong_king, int weak_king, int pawn_sq, int side_to_move)
+{
+    u64 pawn_mask = 1ULL << pawn_sq;
+    u64 weak_mask = 1ULL << weak_king;
+
+    // overlapping pieces, touching kings, or the weak king in check with the strong side to move
+    if (strong_king == weak_king || strong_king == pawn_sq || weak_king == pawn_sq) return KPK_INVALID;
+    if (king_attacks[strong_king] & weak_mask) return KPK_INVALID;
+    if (side_to_move == WHITE && (pawn_attacks[WHITE][pawn_sq] & weak_mask)) return KPK_INVALID;
+
+    if (side_to_move == WHITE)
+    {
+        // promoting wins as long as the new queen can't just be taken
+        int promotion_sq = pawn_sq + 8;
+        u64 promotion_mask = 1ULL << promotion_sq;
+        if (pawn_sq / NUM_FILES == rank_7 && promotion_sq != strong_king && promotion_sq != weak_king && (!(king_attacks[weak_king] & promotion_mask) || (king_attacks[strong_king] & promotion_mask))) return KPK_WIN;
+    }
+    else
+    {
+        // the weak king takes an undefended pawn, or has nowhere to go
+        u64 covered = king_attacks[strong_king] | pawn_attacks[WHITE][pawn_sq];
+        if (king_attacks[weak_king] & pawn_mask & ~king_attacks[strong_king]) return KPK_DRAW;
+        if ((king_attacks[weak_king] & ~covered) == 0) return (pawn_attacks[WHITE][pawn_sq] & weak_mask) ? KPK_WIN : KPK_DRAW;
+    }
+
+    return KPK_UNKNOWN;
+}
+
+void generate_kpk_bitbase()
+{
+    vector<u8> results(KPK_POSITIONS);
+    for (int pawn_sq = h2; pawn_sq <= a7; pawn_sq++)
+    {
+        if (pawn_sq % NUM_FILES < 4) continue;
+        for (int strong_king = 0; strong_king < NUM_SQUARES; strong_king++)
+        {
+            for (int weak_king = 0; weak_king < NUM_SQUARES; weak_king++)
+            {
+                for (int side = 0; side < NUM_COLORS; side++) results[kpk_index(strong_king, weak_king, pawn_sq, side)] = classify(strong_king, weak_king, pawn_sq, side);
+            }
+        }
+    }
+
+    // retrograde iteration: settle every unknown position whose successors decide it, until nothing changes
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int pawn_sq = h2; pawn_sq <= a7; pawn_sq++)
+        {
+            if (pawn_sq % NUM_FILES < 4) continue;
+            for (int strong_king = 0; strong_king < NUM_SQUARES; strong_king++)
+            {
+                for (int weak_king = 0; weak_king < NUM_SQUARES; weak_king++)
+                {
+                    for (int side = 0; side < NUM_COLORS; side++)
+                    {
+                        int index = kpk_index(strong_king, weak_king, pawn_sq, side);
+                        if (results[index] != KPK_UNKNOWN) continue;
+
+                        // the strong side wins if any move wins; the weak side draws if any move draws
+                        KPKResult good = side == WHITE ? KPK_WIN : KPK_DRAW;
+                        KPKResult bad = side == WHITE ? KPK_DRAW : KPK_WIN;
+                        bool found_good = false;
+                        bool all_bad = true;
+
+                        if (side == WHITE)
+                        {
+                            u64 king_moves = king_attacks[strong_king] & ~king_attacks[weak_king] & ~(1ULL << pawn_sq);
+                            while (king_moves > 0)
+                            {
+                                u8 result = results[kpk_index(lsb(king_moves), weak_king, pawn_sq, BLACK)];
+                                found_good |= result == good;
+                                all_bad &= result == bad;
+                                king_moves &= (king_moves - 1);
+                            }
+
+                            // pushes; a promotion that wasn't an immediate win loses the queen
+                            int push_sq = pawn_sq + 8;
+                            if (push_sq != strong_king && push_sq != weak_king && push_sq / NUM_FILES < rank_8)
+                            {
+                                u8 result = results[kpk_index(strong_king, weak_king, push_sq, BLACK)];
+                                found_good |= result == good;
+                                all_bad &= result == bad;
+
+                                int double_sq = push_sq + 8;
+                                if (pawn_sq / NUM_FILES == rank_2 && double_sq != strong_king && double_sq != weak_king)
+                                {
+                                    result = results[kpk_index(strong_king, weak_king, double_sq, BLACK)];
+                                    found_good |= result == good;
+                                    all_bad &= result == bad;
+                                }
+                            }
+                        }
+                        else
+                        {
+                            u64 king_moves = king_attacks[weak_king] & ~(king_attacks[strong_king] | pawn_attacks[WHITE][pawn_sq] | (1ULL << pawn_sq));
+                            while (king_moves > 0)
+                            {
+                                u8 result = results[kpk_index(strong_king, lsb(king_moves), pawn_sq, WHITE)];
+                                found_good |= result == good;
+                                all_bad &= result == bad;
+                                king_moves &= (king_moves - 1);
+                            }
+                        }
+
+                        if (found_good || all_bad)
+                        {
+                            results[index] = found_good ? good : bad;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < KPK_POSITIONS / 64; i++) kpk_bitbase[i] = 0ULL;
+    for (int i = 0; i < KPK_POSITIONS; i++)
+    {
+        if (results[i] == KPK_WIN) kpk_bitbase[i / 64] |= 1ULL << (i % 64);
+    }
+}
+
+bool probe_kpk(Color strong_side, Square strong_king, Square pawn_sq, Square weak_king, Color side_to_move)
+{
+    // flip ranks so the strong side is white, and files so the pawn is on a-d
+    int flip = strong_side == WHITE ? 0 : 56;
+    if ((pawn_sq ^ flip) % NUM_FILES < 4) flip ^= 7;
+
+    int index = kpk_index(strong_king ^ flip, weak_king ^ flip, pawn_sq ^ flip, side_to_move == strong_side ? WHITE : BLACK);
+    return (kpk_bitbase[index / 64] >> (index % 64)) & 1ULL;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+#include "constants.h"
+
+// one bit per king + pawn vs king position with the pawn on files a-d, set when the pawn's side wins;
+// indexed by pawn square, strong king, weak king and side to move, with the strong side always white
+extern u64 kpk_bitbase[KPK_POSITIONS / 64];
+
+// retrograde analysis over every position, run once at setup; needs the king and pawn attack tables
+void generate_kpk_bitbase();
+
+// whether the side with the pawn wins; squares are for the real board, whichever side is strong
+bool probe_kpk(Color strong_side, Square strong_king, Square pawn_sq, Square weak_king, Color side_to_move);
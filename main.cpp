@@ -1,24 +1,83 @@
 #include "gauntlet.h"
 #include "negamax.h"
 #include "alpha_beta_search.h"
+#include "tuner.h"
+#include "tablebase.h"
 #include <iostream>
+#include <fstream>
+#include <thread>
 
-int main()  
+int main(int argc, char** argv)
 {
     // setup params and 2 contestants
     setup();
 
+    // "hash <MB> ...": size every search's transposition table before running whatever follows
+    u64 hash_mb = DEFAULT_TT_MB;
+    if (argc >= 3 && string(argv[1]) == "hash")
+    {
+        hash_mb = stoull(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+
+    // "tune <positions file> [epochs]": fit the eval params to labelled positions instead of playing
+    if (argc >= 3 && string(argv[1]) == "tune")
+    {
+        Tuner tuner(thread::hardware_concurrency());
+        if (!tuner.load(argv[2])) return 1;
+
+        EvalParams tuned = tuner.tune(Evaluator::default_params(), argc >= 4 ? stoi(argv[3]) : 100);
+        Tuner::print_params(tuned);
+        return 0;
+    }
+
+    // "tbgen <directory>": build every 3- and 4-man table into the directory, keeping any already there
+    if (argc >= 3 && string(argv[1]) == "tbgen")
+    {
+        if (!Tablebases::generate(argv[2])) return 1;
+        cout << "Generated " << Tablebases::get_table_count() << " tables." << endl;
+        return 0;
+    }
+
+    // "analyze <fen> <ms> [hash file]": search one position; a hash file is mapped if it exists, so earlier work is reused and kept, otherwise the table is saved to it afterwards
+    if (argc >= 4 && string(argv[1]) == "analyze")
+    {
+        Tablebases::load("tablebases");
+        if (ifstream("nnue.bin").good()) NNUE::load("nnue.bin");
+
+        Board board(argv[2]);
+        AlphaBeta search;
+        search.set_hash_size(hash_mb);
+        bool mapped = argc >= 5 && ifstream(argv[4]).good() && search.map_hash(argv[4]);
+        ConsoleProgress console;
+        search.set_progress(&console);
+        search.set_time_control(stoi(argv[3]));
+        search.deepening_search(board);
+        if (argc >= 5 && !mapped && !search.save_hash(argv[4])) return 1;
+        return 0;
+    }
+
+    // endgame tables, if they have been generated next to the engine
+    Tablebases::load("tablebases");
+
+    // evaluation network, if one has been trained and placed next to the engine
+    if (ifstream("nnue.bin").good()) NNUE::load("nnue.bin");
+
     Search* one = new AlphaBeta();
     Search* two = new AlphaBeta();
-    two->set_search_flags({true, false});
+    two->set_search_flags({true, false, true, true});
+    one->set_hash_size(hash_mb);
+    two->set_hash_size(hash_mb);
 
-    EvalParams params1 = {{100, 300, 300, 500, 900, 1000}};
-    EvalParams params2 = {{100, 300, 300, 500, 900, 1000}};
+    // each search evaluates with its own weights
+    one->set_eval_weights(Evaluator::make_weights(Evaluator::default_params()));
+    two->set_eval_weights(Evaluator::make_weights(Evaluator::default_params()));
 
     // run tournament
     int num_rounds = 100;
     int time_control = 25;
-    pair<int, int> wins_and_draws = Gauntlet::fight(one, two, params1, params2, num_rounds, time_control);
+    pair<int, int> wins_and_draws = Gauntlet::fight(one, two, num_rounds, time_control);
     Gauntlet::interpret_results(wins_and_draws, num_rounds);
 
     // free heap memory
@@ -29,6 +29,35 @@ typedef struct Move {
     MoveType move_type;
 } Move;
 
+// compare two moves by squares and move type
+inline bool same_move(Move a, Move b)
+{
+    return a.from == b.from && a.to == b.to && a.move_type == b.move_type;
+}
+
+// pack a move into 16 bits (6 bits from, 6 bits to, 4 bits type); 0 encodes the null move
+inline u16 encode_move(Move m)
+{
+    if (m.from == null) return 0;
+    return m.from | (m.to << 6) | (m.move_type << 12);
+}
+
+inline Move decode_move(u16 packed)
+{
+    if (packed == 0) return {null, null, QUIET};
+    return {static_cast<Square>(packed & 63), static_cast<Square>((packed >> 6) & 63), static_cast<MoveType>(packed >> 12)};
+}
+
+// long algebraic notation, e.g. e2e4 or e7e8q
+inline string stringify_move(Move m)
+{
+    string promotion_chars = "nbrq";
+    string move_string = stringify_square(m.from) + stringify_square(m.to);
+    if (m.move_type >= KNIGHT_PROMOTION_CAPTURE) move_string += promotion_chars[m.move_type - KNIGHT_PROMOTION_CAPTURE];
+    else if (m.move_type >= KNIGHT_PROMOTION) move_string += promotion_chars[m.move_type - KNIGHT_PROMOTION];
+    return move_string;
+}
+
 typedef struct MoveList {
     Move moves[MAX_MOVES];
     int count = 0;
@@ -1,59 +1,36 @@
 #include "moveorder.h"
+#include <utility>
 
 int piece_values[NUM_PIECES] = {100, 300, 300, 500, 900, 1000};
 
-int get_move_value(Board& board, Move move, MoveOrderFlags flags, Move best_move)
+int get_order_flags(MoveOrderFlags flags)
 {
-    int score = 0;
-
-    // Best move score
-    if (move.from == best_move.from && move.to == best_move.to && move.move_type == best_move.move_type) score += 10000;
-
-    // MVV-LVA score
-    if (flags.mvv_lva && (move.move_type == CAPTURE || move.move_type >= KNIGHT_PROMOTION_CAPTURE))
-    {
-        Piece attacker = board.piece_at_square_for_side(move.from, board.get_side_to_move());
-        Piece victim = board.piece_at_square_for_side(move.to, static_cast<Color>(1-board.get_side_to_move()));
-        score += piece_values[victim] - piece_values[attacker];
-    }
+    return (flags.mvv_lva ? ORDER_MVV_LVA : 0) | (flags.promotion ? ORDER_PROMOTION : 0) | (flags.killers ? ORDER_KILLERS : 0);
+}
 
-    // Promotion score
-    if (flags.promotion && move.move_type >= KNIGHT_PROMOTION)
-    {
-        if (move.move_type >= KNIGHT_PROMOTION_CAPTURE)
-        {
-            score += piece_values[move.move_type - KNIGHT_PROMOTION_CAPTURE + 1];
-        }
-        else
-        {
-            score += piece_values[move.move_type - KNIGHT_PROMOTION + 1];
-        }
-    }
+typedef int (*MoveValueKernel)(Board&, Move, Move, Move*);
+typedef void (*OrderKernel)(Board&, MoveList&, Move, Move*);
 
-    return score; 
+template<int... order_sets>
+static MoveValueKernel select_move_value_kernel(int order_set, std::integer_sequence<int, order_sets...>)
+{
+    static const MoveValueKernel kernels[] = { &get_move_value<order_sets>... };
+    return kernels[order_set];
 }
 
-void order_moves(Board& board, MoveList& moves, MoveOrderFlags flags, Move best_move)
+template<int... order_sets>
+static OrderKernel select_order_kernel(int order_set, std::integer_sequence<int, order_sets...>)
 {
-    // store score for each move
-    int scores[moves.count];
-    for (int i = 0; i < moves.count; i++)
-    {
-        scores[i] = get_move_value(board, moves.moves[i], flags, best_move);
-    }
+    static const OrderKernel kernels[] = { &order_moves<order_sets>... };
+    return kernels[order_set];
+}
 
-    // apply basic insertion sort on move list
-    for (int i = 1; i < moves.count; ++i) {
-        int key = scores[i];
-        Move move_key = moves.moves[i];
-        int j = i - 1;
+int get_move_value(Board& board, Move move, MoveOrderFlags flags, Move best_move, Move* killers)
+{
+    return select_move_value_kernel(get_order_flags(flags), std::make_integer_sequence<int, NUM_ORDER_SETS>())(board, move, best_move, killers);
+}
 
-        while (j >= 0 && scores[j] < key) {
-            scores[j + 1] = scores[j];
-            moves.moves[j+1] = moves.moves[j];
-            j = j - 1;
-        }
-        scores[j + 1] = key;
-        moves.moves[j + 1] = move_key;
-    }
+void order_moves(Board& board, MoveList& moves, MoveOrderFlags flags, Move best_move, Move* killers)
+{
+    select_order_kernel(get_order_flags(flags), std::make_integer_sequence<int, NUM_ORDER_SETS>())(board, moves, best_move, killers);
 }
\ No newline at end of file
@@ -5,9 +5,83 @@
 typedef struct MoveOrderFlags {
     bool mvv_lva;
     bool promotion;
+    bool killers;
 } MoveOrderFlags;
 
+// move ordering flags packed into bits so ordering can be specialized at compile time
+#define ORDER_MVV_LVA 1
+#define ORDER_PROMOTION 2
+#define ORDER_KILLERS 4
+#define NUM_ORDER_SETS 8
+
 extern int piece_values[NUM_PIECES];
 
-int get_move_value(Board& board, Move move, MoveOrderFlags flags, Move best_move);
-void order_moves(Board& board, MoveList& moves, MoveOrderFlags flags, Move best_move);
\ No newline at end of file
+template<int order_flags>
+inline int get_move_value(Board& board, Move move, Move best_move, Move* killers)
+{
+    int score = 0;
+
+    // Best move score
+    if (move.from == best_move.from && move.to == best_move.to && move.move_type == best_move.move_type) score += 10000;
+
+    // MVV-LVA score
+    if ((order_flags & ORDER_MVV_LVA) && (move.move_type == CAPTURE || move.move_type >= KNIGHT_PROMOTION_CAPTURE))
+    {
+        Piece attacker = board.piece_at_square_for_side(move.from, board.get_side_to_move());
+        Piece victim = board.piece_at_square_for_side(move.to, static_cast<Color>(1-board.get_side_to_move()));
+        score += piece_values[victim] - piece_values[attacker];
+    }
+
+    // Killer score (quiet moves that caused a cutoff at this ply), between winning and losing captures
+    if ((order_flags & ORDER_KILLERS) && killers != nullptr && move.move_type < CAPTURE)
+    {
+        if (same_move(move, killers[0])) score += 60;
+        else if (same_move(move, killers[1])) score += 50;
+    }
+
+    // Promotion score
+    if ((order_flags & ORDER_PROMOTION) && move.move_type >= KNIGHT_PROMOTION)
+    {
+        if (move.move_type >= KNIGHT_PROMOTION_CAPTURE)
+        {
+            score += piece_values[move.move_type - KNIGHT_PROMOTION_CAPTURE + 1];
+        }
+        else
+        {
+            score += piece_values[move.move_type - KNIGHT_PROMOTION + 1];
+        }
+    }
+
+    return score; 
+}
+
+template<int order_flags>
+inline void order_moves(Board& board, MoveList& moves, Move best_move, Move* killers)
+{
+    // store score for each move
+    int scores[moves.count];
+    for (int i = 0; i < moves.count; i++)
+    {
+        scores[i] = get_move_value<order_flags>(board, moves.moves[i], best_move, killers);
+    }
+
+    // apply basic insertion sort on move list
+    for (int i = 1; i < moves.count; ++i) {
+        int key = scores[i];
+        Move move_key = moves.moves[i];
+        int j = i - 1;
+
+        while (j >= 0 && scores[j] < key) {
+            scores[j + 1] = scores[j];
+            moves.moves[j+1] = moves.moves[j];
+            j = j - 1;
+        }
+        scores[j + 1] = key;
+        moves.moves[j + 1] = move_key;
+    }
+}
+
+// runtime versions, dispatching to the specialization that matches the flags
+int get_order_flags(MoveOrderFlags flags);
+int get_move_value(Board& board, Move move, MoveOrderFlags flags, Move best_move, Move* killers = nullptr);
+void order_moves(Board& board, MoveList& moves, MoveOrderFlags flags, Move best_move, Move* killers = nullptr);
\ No newline at end of file
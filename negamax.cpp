@@ -2,12 +2,15 @@
 
 Negamax::Negamax()
 {
-    stats.nodes_searched = 0;
+    stats = {};
     time_control = 1000; // 1 second by default
 }
 
 int Negamax::search(Board& board, int alpha, int beta, int depth, int ply)
 {
+    // reset this ply's pv
+    init_ply(ply);
+
     // check for time
     if (time_exceeded())
     {
@@ -18,7 +21,7 @@ int Negamax::search(Board& board, int alpha, int beta, int depth, int ply)
     stats.nodes_searched++;
 
     // return static eval of position at leaf node
-    if (depth == 0) return Evaluate::eval(board);
+    if (depth == 0) return evaluator.eval(board);
 
     // generate pseudo legal moves
     int max = -MAX_BOUND;
@@ -44,6 +47,7 @@ int Negamax::search(Board& board, int alpha, int beta, int depth, int ply)
             {
                 if (ply == 0) best_move = m;
                 max = score;
+                update_pv(ply, m);
             }
         }
 
@@ -63,6 +67,39 @@ int Negamax::search(Board& board, int alpha, int beta, int depth, int ply)
     return max; 
 }
 
+int Negamax::search_root(Board& board, int alpha, int beta, int depth)
+{
+    // reset the root's pv
+    init_ply(0);
+
+    // increment nodes searched
+    stats.nodes_searched++;
+
+    // loop through the root moves this line hasn't handed to an earlier one
+    int max = -MAX_BOUND;
+    for (int i = pv_index; i < root_moves.count; i++)
+    {
+        RootMove& root_move = root_moves.moves[i];
+        int nodes_before = stats.nodes_searched;
+
+        PreviousState prev = board.make_move(root_move.move);
+        int score = -search(board, alpha, beta, depth-1, 1);
+        board.unmake_move(root_move.move, prev);
+
+        // record subtree size and score for reordering
+        root_move.nodes = stats.nodes_searched - nodes_before;
+        root_move.score = score;
+        if (score > max)
+        {
+            best_move = root_move.move;
+            max = score;
+            update_pv(0, root_move.move);
+        }
+    }
+
+    return max;
+}
+
 SearchStats Negamax::get_stats()
 {
     return stats;
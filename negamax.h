@@ -2,10 +2,6 @@
 #include "search.h"
 #include "evaluate.h"
 
-typedef struct SearchStats {
-    int nodes_searched;
-} SearchStats;
-
 class Negamax : public Search
 {
     protected:
@@ -16,6 +12,8 @@ class Negamax : public Search
 
         // search
         int search(Board& board, int alpha, int beta, int depth, int ply) override;
+        int search_root(Board& board, int alpha, int beta, int depth) override;
+        void report_stats(int depth) override { progress->on_stats(depth, stats, 0); }
 
         // getters 
         SearchStats get_stats();
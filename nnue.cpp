@@ -0,0 +1,238 @@
+#include "nnue.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// define network weights
+const NNUEWeights* NNUE::weights = nullptr;
+void* NNUE::mapping = nullptr;
+u64 NNUE::mapping_bytes = 0;
+
+// magic bytes identifying a network file
+static const char NNUE_FILE_MAGIC[8] = {'T', 'B', 'O', 'L', 'T', 'N', 'N', '\0'};
+
+void NNUE::unload()
+{
+    if (mapping == nullptr) return;
+#ifdef _WIN32
+    _aligned_free(mapping);
+#else
+    munmap(mapping, mapping_bytes);
+#endif
+    mapping = nullptr;
+    weights = nullptr;
+}
+
+bool NNUE::load(string file_name)
+{
+    u64 bytes = sizeof(NNUEFileHeader) + sizeof(NNUEWeights);
+    void* new_mapping = nullptr;
+
+#ifdef _WIN32
+    // no mmap here; read the file into an aligned buffer instead
+    ifstream file(file_name, ios::binary);
+    if (!file.is_open())
+    {
+        cout << "Error. Could not open " << file_name << "." << endl;
+        return false;
+    }
+
+    new_mapping = _aligned_malloc(bytes, CACHE_LINE_SIZE);
+    file.read(static_cast<char*>(new_mapping), bytes);
+    if (file.gcount() != static_cast<std::streamsize>(bytes) || file.peek() != EOF)
+    {
+        cout << "Error. " << file_name << " is not a network for this build." << endl;
+        _aligned_free(new_mapping);
+        return false;
+    }
+#else
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cout << "Error. Could not open " << file_name << "." << endl;
+        return false;
+    }
+
+    if (static_cast<u64>(lseek(fd, 0, SEEK_END)) != bytes)
+    {
+        cout << "Error. " << file_name << " is not a network for this build." << endl;
+        close(fd);
+        return false;
+    }
+
+    new_mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (new_mapping == MAP_FAILED)
+    {
+        cout << "Error. Could not map " << file_name << "." << endl;
+        return false;
+    }
+#endif
+
+    // check the header matches the architecture this build was compiled for
+    const NNUEFileHeader* header = static_cast<const NNUEFileHeader*>(new_mapping);
+    if (memcmp(header->magic, NNUE_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != NNUE_FILE_VERSION || header->inputs != NNUE_INPUTS || header->hidden != NNUE_HIDDEN)
+    {
+        cout << "Error. " << file_name << " is not a network for this build." << endl;
+#ifdef _WIN32
+        _aligned_free(new_mapping);
+#else
+        munmap(new_mapping, bytes);
+#endif
+        return false;
+    }
+
+    unload();
+    mapping = new_mapping;
+    mapping_bytes = bytes;
+    weights = reinterpret_cast<const NNUEWeights*>(header + 1);
+    return true;
+}
+
+NNUEStack::NNUEStack()
+{
+    entries = new NNUEAccumulator[NNUE_STACK_SIZE];
+    top = 0;
+    entries[0].computed = false;
+    entries[0].dirty_count = 0;
+}
+
+NNUEStack::~NNUEStack()
+{
+    delete[] entries;
+}
+
+void NNUEStack::reset(Board& board)
+{
+    top = 0;
+    entries[0].dirty_count = 0;
+    refresh(board, entries[0]);
+}
+
+void NNUEStack::refresh(Board& board, NNUEAccumulator& accumulator)
+{
+    const NNUEWeights& w = NNUE::get_weights();
+
+    // biases plus the column of every piece on the board, for both perspectives
+    for (int perspective = 0; perspective < NUM_COLORS; perspective++)
+    {
+        short* values = accumulator.values[perspective];
+        for (int i = 0; i < NNUE_HIDDEN; i++) values[i] = w.feature_biases[i];
+
+        for (int side = 0; side < NUM_COLORS; side++)
+        {
+            for (int piece = 0; piece < NUM_PIECES; piece++)
+            {
+                u64 occ = board.get_piece_occupancy(static_cast<Color>(side), static_cast<Piece>(piece));
+                while (occ > 0)
+                {
+                    Square sq = static_cast<Square>(lsb(occ));
+                    const short* column = w.feature_weights[NNUE::feature_index(static_cast<Color>(perspective), static_cast<Color>(side), static_cast<Piece>(piece), sq)];
+                    for (int i = 0; i < NNUE_HIDDEN; i++) values[i] += column[i];
+                    occ &= (occ - 1);
+                }
+            }
+        }
+    }
+
+    accumulator.computed = true;
+}
+
+void NNUEStack::update(NNUEAccumulator& parent, NNUEAccumulator& child)
+{
+    const NNUEWeights& w = NNUE::get_weights();
+
+    // child = parent with each dirty piece's column added or removed
+    for (int perspective = 0; perspective < NUM_COLORS; perspective++)
+    {
+        short* values = child.values[perspective];
+        memcpy(values, parent.values[perspective], sizeof(child.values[perspective]));
+
+        for (int j = 0; j < child.dirty_count; j++)
+        {
+            NNUEDirtyPiece& dirty = child.dirty[j];
+            const short* column = w.feature_weights[NNUE::feature_index(static_cast<Color>(perspective), dirty.side, dirty.piece, dirty.sq)];
+            if (dirty.added) for (int i = 0; i < NNUE_HIDDEN; i++) values[i] += column[i];
+            else for (int i = 0; i < NNUE_HIDDEN; i++) values[i] -= column[i];
+        }
+    }
+
+    child.computed = true;
+}
+
+// sum of clamp(values, 0, NNUE_QA) * weights over the hidden layer
+static int crelu_dot(const short* values, const short* weights)
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NNUE_QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+        v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NNUE_QA);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+        v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN; i++) sum += min(max(static_cast<int>(values[i]), 0), NNUE_QA) * weights[i];
+    return sum;
+#endif
+}
+
+int NNUEStack::evaluate(Board& board)
+{
+    // walk back to the nearest computed accumulator, then bring each ply after it up to date
+    int computed = top;
+    while (!entries[computed].computed)
+    {
+        if (computed == 0)
+        {
+            refresh(board, entries[top]);
+            break;
+        }
+        computed--;
+    }
+    for (int i = computed + 1; i <= top && !entries[top].computed; i++) update(entries[i - 1], entries[i]);
+
+    // side to move's half of the hidden layer first, then the other side's
+    const NNUEWeights& w = NNUE::get_weights();
+    NNUEAccumulator& accumulator = entries[top];
+    Color us = board.get_side_to_move();
+    Color them = us == WHITE ? BLACK : WHITE;
+
+    int output = crelu_dot(accumulator.values[us], w.output_weights) + crelu_dot(accumulator.values[them], w.output_weights + NNUE_HIDDEN);
+    int score = (output + w.output_bias) * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+
+    // keep whatever the network says clear of the mate range
+    int limit = CHECKMATE_SCORE - CHECKMATE_WINDOW - 1;
+    return max(-limit, min(score, limit));
+}
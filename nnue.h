@@ -0,0 +1,92 @@
+#pragma once
+#include "board.h"
+
+// network weights as laid out in the file, after the header
+typedef struct alignas(CACHE_LINE_SIZE) NNUEWeights {
+    short feature_weights[NNUE_INPUTS][NNUE_HIDDEN];
+    short feature_biases[NNUE_HIDDEN];
+    short output_weights[NUM_COLORS * NNUE_HIDDEN];
+    short output_bias;
+} NNUEWeights;
+
+// header at the start of a network file; a full cache line, so the weights behind it stay aligned when mapped
+typedef struct alignas(CACHE_LINE_SIZE) NNUEFileHeader {
+    char magic[8];
+    u32 version;
+    u32 inputs;
+    u32 hidden;
+} NNUEFileHeader;
+
+// a piece that appeared on or left a square during a move
+typedef struct NNUEDirtyPiece {
+    Color side;
+    Piece piece;
+    Square sq;
+    bool added;
+} NNUEDirtyPiece;
+
+// hidden layer for both perspectives at one ply; computed lazily from the nearest computed parent and this ply's dirty pieces
+typedef struct alignas(CACHE_LINE_SIZE) NNUEAccumulator {
+    short values[NUM_COLORS][NNUE_HIDDEN];
+    bool computed;
+    int dirty_count;
+    NNUEDirtyPiece dirty[4];
+} NNUEAccumulator;
+
+class NNUE
+{
+    private:
+        // weights are shared by every stack, mapped read-only from the file
+        static const NNUEWeights* weights;
+        static void* mapping;
+        static u64 mapping_bytes;
+
+        static void unload();
+    public:
+        static bool load(string file_name);
+        static bool is_loaded() { return weights != nullptr; }
+        static const NNUEWeights& get_weights() { return *weights; }
+
+        // input index of a piece seen from one side: own pieces first, squares flipped for black
+        static int feature_index(Color perspective, Color side, Piece piece, Square sq)
+        {
+            int relative_sq = perspective == WHITE ? sq : sq ^ 56;
+            return (side != perspective) * NUM_PIECES * NUM_SQUARES + piece * NUM_SQUARES + relative_sq;
+        }
+};
+
+// per-ply accumulators for one searcher; attached to the board so make_move/unmake_move can push, record and pop
+class NNUEStack
+{
+    private:
+        NNUEAccumulator* entries;
+        int top;
+
+        void refresh(Board& board, NNUEAccumulator& accumulator);
+        void update(NNUEAccumulator& parent, NNUEAccumulator& child);
+    public:
+        NNUEStack();
+        ~NNUEStack();
+        NNUEStack(const NNUEStack&) = delete;
+        NNUEStack& operator=(const NNUEStack&) = delete;
+
+        // rebuild the root accumulator from the board's pieces
+        void reset(Board& board);
+
+        // called by the board as it makes and unmakes moves
+        void push()
+        {
+            top++;
+            entries[top].computed = false;
+            entries[top].dirty_count = 0;
+        }
+        void pop() { top--; }
+        void record(Color side, Piece piece, Square sq, bool added)
+        {
+            NNUEAccumulator& accumulator = entries[top];
+            accumulator.dirty[accumulator.dirty_count++] = {side, piece, sq, added};
+        }
+
+        // network output in centipawns from the side to move's point of view
+        int evaluate(Board& board);
+};
@@ -1,41 +1,157 @@
 #pragma once
 #include "board.h"
 #include "moveorder.h"
+#include "transposition.h"
+#include "evaluate.h"
+#include "tablebase.h"
 #include <iostream>
 
 typedef struct SearchFlags {
     bool check_extend;
     bool transposition;
+    bool nnue;
+    bool tablebases;
 } SearchFlags;
 
+typedef struct PVLine {
+    Move moves[MAX_PLY];
+    int length;
+    int score;
+} PVLine;
+
+typedef struct RootMove {
+    Move move;
+    int score;
+    u64 nodes;
+} RootMove;
+
+// legal root moves, built once per search and reordered after every iteration
+typedef struct RootMoveList {
+    RootMove moves[MAX_MOVES];
+    int count = 0;
+} RootMoveList;
+
+// per-ply search state; the pv rows together form a triangular pv table
+typedef struct SearchStackEntry {
+    Move pv[MAX_PLY];
+    int pv_length;
+    Move killers[2];
+} SearchStackEntry;
+
+typedef struct SearchStats {
+    int nodes_searched;
+
+    // transposition table behaviour this search; a collision is a hit whose move isn't playable here
+    u64 tt_probes;
+    u64 tt_hits;
+    u64 tt_cutoffs;
+    u64 tt_collisions;
+    u64 tt_stores[NUM_TT_STORES];
+
+    // static evaluations asked for, and how many of them the eval cache answered
+    u64 eval_probes;
+    u64 eval_hits;
+
+    // quiescence evals that stopped after material + piece-square terms
+    u64 eval_lazy_exits;
+
+    // nodes answered by an endgame table instead of searched
+    u64 tb_hits;
+} SearchStats;
+
+// receives the principal variations found at the end of every completed iteration, and optionally the search's counters
+class SearchProgress
+{
+    public:
+        virtual ~SearchProgress() = default;
+        virtual void on_iteration(int depth, PVLine* lines, int line_count) = 0;
+        virtual void on_stats(int /* depth */, SearchStats& /* stats */, int /* hashfull */) {}
+};
+
+class ConsoleProgress : public SearchProgress
+{
+    public:
+        void on_iteration(int depth, PVLine* lines, int line_count) override
+        {
+            for (int i = 0; i < line_count; i++)
+            {
+                cout << "Depth: " << depth << ", " << "MultiPV: " << i + 1 << ", " << "Score: " << lines[i].score << ", " << "PV:";
+                for (int j = 0; j < lines[i].length; j++) cout << " " << stringify_move(lines[i].moves[j]);
+                cout << endl;
+            }
+        }
+
+        void on_stats(int depth, SearchStats& stats, int hashfull) override
+        {
+            if (stats.tt_probes == 0) return;
+            cout << "Depth: " << depth << ", TT probes: " << stats.tt_probes << ", hits: " << stats.tt_hits << " (" << stats.tt_hits * 100 / stats.tt_probes << "%)";
+            cout << ", cutoffs: " << stats.tt_cutoffs << ", collisions: " << stats.tt_collisions;
+            cout << ", stores empty/same/stale/shallow/skipped: " << stats.tt_stores[STORE_EMPTY] << "/" << stats.tt_stores[STORE_SAME_POSITION] << "/" << stats.tt_stores[STORE_REPLACE_STALE] << "/" << stats.tt_stores[STORE_REPLACE_SHALLOW] << "/" << stats.tt_stores[STORE_SKIPPED];
+            cout << ", hashfull: " << hashfull;
+            if (stats.eval_probes > 0) cout << ", eval cache hits: " << stats.eval_hits << " (" << stats.eval_hits * 100 / stats.eval_probes << "%)";
+            if (stats.eval_probes > stats.eval_hits) cout << ", lazy exits: " << stats.eval_lazy_exits << " (" << stats.eval_lazy_exits * 100 / (stats.eval_probes - stats.eval_hits) << "%)";
+            if (stats.tb_hits > 0) cout << ", tb hits: " << stats.tb_hits;
+            cout << endl;
+        }
+};
+
 class Search
 {
     protected:
         // store best move
         Move best_move;
 
+        // root moves; multi-pv line k searches root_moves[k..count), earlier lines having claimed the moves before it
+        RootMoveList root_moves;
+        int pv_index = 0;
+
+        // multi-pv lines from the last completed iteration
+        int multi_pv = 1;
+        PVLine pv_lines[MAX_MULTI_PV];
+        int pv_line_count = 0;
+        SearchProgress* progress = nullptr;
+
+        // search stack, plus whether the current node still lies on the previous iteration's pv
+        SearchStackEntry stack[MAX_PLY + 1];
+        bool follow_pv = false;
+
         // time control
         std::chrono::steady_clock::time_point start_time;
         int time_control;
 
+        // this search's own evaluator; its weights may be shared with other searches, its caches are not
+        Evaluator evaluator;
+
         // flags
         MoveOrderFlags move_order_flags;
-        SearchFlags search_flags;
+        SearchFlags search_flags = {};
     public:
         // constructor/destructor
         virtual ~Search() = default;
 
         // getters
         virtual Move get_best_move() { return best_move; }
+        PVLine* get_pv_lines() { return pv_lines; }
+        PVLine get_pv() { return pv_lines[0]; }
+        int get_pv_line_count() { return pv_line_count; }
 
         // setters
         virtual void set_move_order_flags(MoveOrderFlags new_flags) { move_order_flags = new_flags; }
         virtual void set_search_flags(SearchFlags new_flags) { search_flags = new_flags; }
         virtual void set_time_control(int time) { time_control = time; }
+        void set_multi_pv(int lines) { multi_pv = max(1, min(lines, MAX_MULTI_PV)); }
+        void set_progress(SearchProgress* new_progress) { progress = new_progress; }
+        virtual void set_hash_size(u64 /* megabytes */) {}
+        void set_eval_weights(std::shared_ptr<const EvalWeights> weights) { evaluator.set_weights(weights); }
+        void set_lazy_margin(int margin) { evaluator.set_lazy_margin(margin); }
+
+        // hash table snapshots, for searches that keep one
+        virtual bool save_hash(string /* file_name */) { return false; }
+        virtual bool map_hash(string /* file_name */) { return false; }
 
         // time
         virtual void start_timer() { start_time = std::chrono::steady_clock::now(); }
-        virtual bool time_exceeded() 
+        virtual bool time_exceeded()
         {
             std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
             int time_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
@@ -43,38 +159,172 @@ class Search
             return false;
         }
 
+        // generate and order the legal root moves once per search
+        void build_root_moves(Board& board)
+        {
+            MoveList moves;
+            board.generate_legal_moves(moves);
+            order_moves(board, moves, move_order_flags, {null, null, QUIET});
+
+            root_moves.count = 0;
+            for (int i = 0; i < moves.count; i++) root_moves.moves[root_moves.count++] = {moves.moves[i], -MAX_BOUND, 0};
+        }
+
+        // stable insertion sort of root_moves[from..count) by score, then by subtree size
+        void sort_root_moves(int from)
+        {
+            for (int i = from + 1; i < root_moves.count; i++)
+            {
+                RootMove key = root_moves.moves[i];
+                int j = i - 1;
+
+                while (j >= from && (root_moves.moves[j].score < key.score || (root_moves.moves[j].score == key.score && root_moves.moves[j].nodes < key.nodes)))
+                {
+                    root_moves.moves[j + 1] = root_moves.moves[j];
+                    j--;
+                }
+                root_moves.moves[j + 1] = key;
+            }
+        }
+
+        // move the previous iteration's line plays at this ply, as long as the search is still following it
+        Move get_pv_move(int ply)
+        {
+            int line = pv_index;
+            if (follow_pv && line < pv_line_count && ply < pv_lines[line].length) return pv_lines[line].moves[ply];
+
+            follow_pv = false;
+            return {null, null, QUIET};
+        }
+
+        // reset this ply's stack entry on entering a node
+        void init_ply(int ply)
+        {
+            stack[ply].pv_length = 0;
+            stack[ply + 1].killers[0] = {null, null, QUIET};
+            stack[ply + 1].killers[1] = {null, null, QUIET};
+        }
+
+        // this ply's pv becomes the move followed by the child's pv
+        void update_pv(int ply, Move m)
+        {
+            SearchStackEntry& entry = stack[ply];
+            SearchStackEntry& child = stack[ply + 1];
+
+            entry.pv[0] = m;
+            for (int i = 0; i < child.pv_length; i++) entry.pv[i + 1] = child.pv[i];
+            entry.pv_length = child.pv_length + 1;
+        }
+
+        // remember a quiet move that caused a beta cutoff at this ply
+        void update_killers(int ply, Move m)
+        {
+            if (m.move_type >= CAPTURE || same_move(m, stack[ply].killers[0])) return;
+            stack[ply].killers[1] = stack[ply].killers[0];
+            stack[ply].killers[0] = m;
+        }
+
+        // with the root inside the tables, play the move they rate best instead of searching
+        bool probe_root(Board& board)
+        {
+            int value;
+            if (!search_flags.tablebases || Tablebases::get_table_count() == 0 || !Tablebases::probe(board, value)) return false;
+
+            RootMove best = {{null, null, QUIET}, -MAX_BOUND, 0};
+            for (int i = 0; i < root_moves.count; i++)
+            {
+                Move m = root_moves.moves[i].move;
+                PreviousState prev_state = board.make_move(m);
+                bool found = Tablebases::probe(board, value);
+                board.unmake_move(m, prev_state);
+                if (!found) return false;
+
+                int score = -Tablebases::to_score(value, 1);
+                if (score > best.score) best = {m, score, 0};
+            }
+
+            pv_lines[0].moves[0] = best.move;
+            pv_lines[0].length = 1;
+            pv_lines[0].score = best.score;
+            pv_line_count = 1;
+            if (progress != nullptr) progress->on_iteration(1, pv_lines, pv_line_count);
+            return true;
+        }
+
         // search
         virtual int search(Board& board, int alpha, int beta, int depth, int ply) = 0;
+        virtual int search_root(Board& board, int alpha, int beta, int depth) = 0;
+        virtual void new_search(Board& /* board */) {}
+        virtual void end_search(Board& /* board */) {}
+        virtual void new_game() {}
+        virtual void report_stats(int /* depth */) {}
         virtual Move deepening_search(Board& board)
-        {   
-            // start timer for search
+        {
+            // start timer for search; score the board with this search's weights, since another search may have played on it last
             start_timer();
+            board.set_eval_weights(evaluator.get_weights());
             Move best_move_so_far = {null, null, QUIET};
+            pv_line_count = 0;
+            stack[0].killers[0] = {null, null, QUIET};
+            stack[0].killers[1] = {null, null, QUIET};
+
+            // if we are checkmated or drawn, make move invalid and don't search at all
+            build_root_moves(board);
+            if (root_moves.count == 0 || board.is_50_move_draw() || board.is_repeat() || board.is_insufficient_material())
+            {
+                board.set_eval_weights(nullptr);
+                return best_move_so_far;
+            }
+            if (probe_root(board))
+            {
+                board.set_eval_weights(nullptr);
+                return pv_lines[0].moves[0];
+            }
+            new_search(board);
 
             // iteratively increase depth for seaerch
             for (int i = 1; i < 99; i++)
             {
-                // search
-                int score = search(board, -MAX_BOUND, MAX_BOUND, i, 0);
-
-                // if we exceed our time limit, stop searching 
-                if (time_exceeded()) 
+                // search the root once per line; each line leaves its move at root_moves[pv_index]
+                PVLine lines[MAX_MULTI_PV];
+                int line_count = 0;
+                for (pv_index = 0; pv_index < min(multi_pv, root_moves.count); pv_index++)
                 {
-                    break;
+                    follow_pv = true;
+                    int score = search_root(board, -MAX_BOUND, MAX_BOUND, i);
+                    if (time_exceeded()) break;
+
+                    // best move of this line first, the rest by score and then node count
+                    sort_root_moves(pv_index);
+
+                    // copy the root's pv row into this line
+                    PVLine& line = lines[line_count++];
+                    for (int j = 0; j < stack[0].pv_length; j++) line.moves[j] = stack[0].pv[j];
+                    line.length = stack[0].pv_length;
+                    line.score = score;
                 }
+                pv_index = 0;
 
-                // if we are checkmated or drawn, make move invalid and stop searching
-                if (board.is_drawn() || board.is_lost()) 
+                // if we exceed our time limit, stop searching
+                if (time_exceeded())
                 {
-                    best_move_so_far = {null, null, QUIET};
                     break;
                 }
 
-                // otherwise, update best move
-                best_move_so_far = get_best_move();
+                // otherwise, update best move and report this iteration's lines
+                for (int j = 0; j < line_count; j++) pv_lines[j] = lines[j];
+                pv_line_count = line_count;
+                best_move_so_far = pv_lines[0].moves[0];
+                if (progress != nullptr)
+                {
+                    progress->on_iteration(i, pv_lines, pv_line_count);
+                    report_stats(i);
+                }
             }
 
-            // return best move found
+            // return best move found; the board may outlive this search, so it goes back to the default weights
+            end_search(board);
+            board.set_eval_weights(nullptr);
             return best_move_so_far;
         }
 };
\ No newline at end of file
@@ -0,0 +1,669 @@
+#include "tablebase.h"
+#include "bitboard.h"
+#include "sliding.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// define tables
+vector<TBTable> Tablebases::tables;
+
+// magic bytes identifying a table file
+static const char TB_FILE_MAGIC[8] = {'T', 'B', 'O', 'L', 'T', 'T', 'B', '\0'};
+
+// per-position state while generating; unknown positions still left at the end are draws
+typedef enum TBState {
+    TB_INVALID,
+    TB_UNKNOWN,
+    TB_WIN,
+    TB_LOSS,
+    TB_PENDING_LOSS, // lost, but not until a later ply than the one being resolved
+    TB_DRAW
+} TBState;
+
+// best exit of a position that can't leave the table by capturing or promoting
+static const signed char TB_NO_EXIT = -128;
+
+// pawnless tables keep the white king in the h1-d1-d4 triangle, indexed rank by rank
+static const int triangle_squares[10] = {h1, g1, f1, e1, g2, f2, e2, f3, e3, e4};
+static const int triangle_offsets[4] = {0, 4, 7, 9};
+
+static bool has_pawns(TBMaterial& material)
+{
+    for (int i = 2; i < material.count; i++)
+    {
+        if (material.pieces[i] == pawn) return true;
+    }
+    return false;
+}
+
+// one of the 8 board symmetries: bit 2 flips along the h1-a8 diagonal, bit 0 mirrors files, bit 1 mirrors ranks
+static int transform_square(int transform, int sq)
+{
+    if (transform & 4) sq = (sq % NUM_FILES) * NUM_FILES + sq / NUM_FILES;
+    if (transform & 1) sq ^= 7;
+    if (transform & 2) sq ^= 56;
+    return sq;
+}
+
+// slot of the white king in the first dimension of the index, or -1 if this orientation puts it outside the region
+static int king_region(int sq, bool pawns)
+{
+    int rank = sq / NUM_FILES;
+    int file = sq % NUM_FILES;
+    if (file > 3) return -1;
+    if (pawns) return rank * 4 + file;
+    if (rank > file) return -1;
+    return triangle_offsets[rank] + file - rank;
+}
+
+// the position behind an index, which may not be legal or the canonical orientation
+static void decode(TBMaterial& material, u64 idx, int* squares, int& side_to_move)
+{
+    side_to_move = idx % 2;
+    idx /= 2;
+    for (int i = material.count - 1; i >= 1; i--)
+    {
+        squares[i] = idx % NUM_SQUARES;
+        idx /= NUM_SQUARES;
+    }
+    squares[0] = has_pawns(material) ? (idx / 4) * NUM_FILES + idx % 4 : triangle_squares[idx];
+}
+
+// whether any of the given color's pieces attacks the target square
+static bool attacked(TBMaterial& material, int* squares, int target, int by)
+{
+    u64 occupancy = 0ULL;
+    for (int i = 0; i < material.count; i++) occupancy |= 1ULL << squares[i];
+
+    for (int i = 0; i < material.count; i++)
+    {
+        if (material.colors[i] != by) continue;
+
+        int sq = squares[i];
+        u64 attacks;
+        switch (material.pieces[i])
+        {
+            case pawn: attacks = pawn_attacks[by][sq]; break;
+            case knight: attacks = knight_attacks[sq]; break;
+            case bishop: attacks = get_bishop_attack(sq, occupancy); break;
+            case rook: attacks = get_rook_attack(sq, occupancy); break;
+            case queen: attacks = get_queen_attack(sq, occupancy); break;
+            default: attacks = king_attacks[sq]; break;
+        }
+        if (attacks & (1ULL << target)) return true;
+    }
+    return false;
+}
+
+// distinct squares, no pawns on the back ranks, and the side that just moved not left in check
+static bool is_legal(TBMaterial& material, int* squares, int side_to_move)
+{
+    u64 occupancy = 0ULL;
+    for (int i = 0; i < material.count; i++)
+    {
+        if (occupancy & (1ULL << squares[i])) return false;
+        if (material.pieces[i] == pawn && (squares[i] / NUM_FILES == rank_1 || squares[i] / NUM_FILES == rank_8)) return false;
+        occupancy |= 1ULL << squares[i];
+    }
+    return !attacked(material, squares, squares[side_to_move ^ 1], side_to_move);
+}
+
+// the value of a position seen from the side that moved into it
+static int flip_value(int value)
+{
+    if (value > 0) return -(value + 2);
+    if (value < 0) return -value;
+    return 0;
+}
+
+// order values by how good they are for the side to move: fast mates first, then draws, then slow losses
+static int preference(int value)
+{
+    if (value > 0) return 1000 - value;
+    if (value < 0) return -1000 - value;
+    return 0;
+}
+
+static u64 material_key(TBMaterial& material)
+{
+    u64 key = 0ULL;
+    for (int i = 2; i < material.count; i++) key += 1ULL << (4 * (material.colors[i] * NUM_PIECES + material.pieces[i]));
+    return key;
+}
+
+// squares of the table's pieces on this board, mirrored top to bottom if the table's white is black here
+static void board_squares(Board& board, TBMaterial& material, bool flipped, int* squares)
+{
+    u64 remaining[NUM_COLORS][NUM_PIECES];
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        for (int piece = 0; piece < NUM_PIECES; piece++) remaining[color][piece] = board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece));
+    }
+
+    for (int i = 0; i < material.count; i++)
+    {
+        u64& occupancy = remaining[material.colors[i] ^ flipped][material.pieces[i]];
+        squares[i] = lsb(occupancy) ^ (flipped ? 56 : 0);
+        occupancy &= occupancy - 1;
+    }
+}
+
+// whether the double push just made leaves the opponent a legal en passant capture; an index can't record that right
+static bool allows_en_passant(Board& board)
+{
+    if (board.get_en_passant_square() == null) return false;
+
+    MoveList moves;
+    board.generate_legal_moves(moves);
+    for (int i = 0; i < moves.count; i++)
+    {
+        if (moves.moves[i].move_type == EN_PASSANT_CAPTURE) return true;
+    }
+    return false;
+}
+
+// every material with at most TB_MAX_PIECES men and white the stronger side, ordered so that
+// captures and promotions only ever lead to tables that come earlier
+static vector<TBMaterial> all_materials()
+{
+    vector<TBMaterial> materials;
+    for (int first = queen; first >= pawn; first--)
+    {
+        materials.push_back({3, {WHITE, BLACK, WHITE}, {king, king, static_cast<Piece>(first)}});
+        for (int second = first; second >= pawn; second--)
+        {
+            materials.push_back({4, {WHITE, BLACK, WHITE, WHITE}, {king, king, static_cast<Piece>(first), static_cast<Piece>(second)}});
+            materials.push_back({4, {WHITE, BLACK, WHITE, BLACK}, {king, king, static_cast<Piece>(first), static_cast<Piece>(second)}});
+        }
+    }
+
+    auto pawn_count = [](const TBMaterial& material) {
+        int count = 0;
+        for (int i = 2; i < material.count; i++) count += material.pieces[i] == pawn;
+        return count;
+    };
+    stable_sort(materials.begin(), materials.end(), [&](const TBMaterial& a, const TBMaterial& b) {
+        return a.count != b.count ? a.count < b.count : pawn_count(a) < pawn_count(b);
+    });
+    return materials;
+}
+
+u64 Tablebases::entry_count(TBMaterial& material)
+{
+    u64 count = has_pawns(material) ? 32 : 10;
+    for (int i = 1; i < material.count; i++) count *= NUM_SQUARES;
+    return count * 2;
+}
+
+u64 Tablebases::index(TBMaterial& material, int* squares, int side_to_move)
+{
+    // the smallest index over the orientations that keep the white king in its region; pawns only allow the file mirror
+    bool pawns = has_pawns(material);
+    u64 best = ~0ULL;
+    for (int transform = 0; transform < (pawns ? 2 : 8); transform++)
+    {
+        int region = king_region(transform_square(transform, squares[0]), pawns);
+        if (region < 0) continue;
+
+        int transformed[TB_MAX_PIECES];
+        for (int i = 0; i < material.count; i++) transformed[i] = transform_square(transform, squares[i]);
+
+        // identical pieces are interchangeable, so keep them in square order
+        for (int i = 3; i < material.count; i++)
+        {
+            if (material.colors[i] == material.colors[i - 1] && material.pieces[i] == material.pieces[i - 1] && transformed[i] < transformed[i - 1]) swap(transformed[i], transformed[i - 1]);
+        }
+
+        u64 idx = region;
+        for (int i = 1; i < material.count; i++) idx = idx * NUM_SQUARES + transformed[i];
+        best = min(best, idx * 2 + side_to_move);
+    }
+    return best;
+}
+
+string Tablebases::name(TBMaterial& material)
+{
+    const char letters[] = "PNBRQK";
+    string white = "K";
+    string black = "K";
+    for (int i = 2; i < material.count; i++)
+    {
+        if (material.colors[i] == WHITE) white += letters[material.pieces[i]];
+        else black += letters[material.pieces[i]];
+    }
+    return white + "v" + black;
+}
+
+TBTable* Tablebases::find(Board& board, bool& flipped)
+{
+    // keys of the board's material as it stands and with the colors swapped
+    u64 key = 0ULL;
+    u64 flipped_key = 0ULL;
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        for (int piece = pawn; piece < king; piece++)
+        {
+            u64 count = pop_count(board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece)));
+            key += count << (4 * (color * NUM_PIECES + piece));
+            flipped_key += count << (4 * ((color ^ 1) * NUM_PIECES + piece));
+        }
+    }
+
+    for (TBTable& table : tables)
+    {
+        flipped = false;
+        if (table.key == key) return &table;
+        flipped = true;
+        if (table.key == flipped_key) return &table;
+    }
+    return nullptr;
+}
+
+bool Tablebases::probe(Board& board, int& value)
+{
+    // tables know nothing of castling or en passant
+    if (board.get_en_passant_square() != null || board.has_castling_rights()) return false;
+
+    int count = 0;
+    for (int color = 0; color < NUM_COLORS; color++)
+    {
+        for (int piece = 0; piece < NUM_PIECES; piece++) count += pop_count(board.get_piece_occupancy(static_cast<Color>(color), static_cast<Piece>(piece)));
+    }
+    if (count > TB_MAX_PIECES) return false;
+
+    // bare kings need no table
+    if (count == 2)
+    {
+        value = 0;
+        return true;
+    }
+
+    bool flipped;
+    TBTable* table = find(board, flipped);
+    if (table == nullptr) return false;
+
+    int squares[TB_MAX_PIECES];
+    board_squares(board, table->material, flipped, squares);
+    value = table->entries[index(table->material, squares, board.get_side_to_move() ^ flipped)];
+    return true;
+}
+
+int Tablebases::to_score(int value, int ply)
+{
+    // mate distances are counted from this node, so they stack on the ply just like a mate found by search
+    if (value > 0) return CHECKMATE_SCORE - ply - value;
+    if (value < 0) return -CHECKMATE_SCORE + ply + (-value - 1);
+    return DRAW_SCORE;
+}
+
+bool Tablebases::map_table(TBMaterial& material, string file_name)
+{
+#ifdef _WIN32
+    cout << "Error. Mapping tablebases is not supported on this platform." << endl;
+    return false;
+#else
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cout << "Error. Could not open " << file_name << "." << endl;
+        return false;
+    }
+
+    // check the header against the material the file name promises
+    TBFileHeader header;
+    bool valid = read(fd, &header, sizeof(header)) == sizeof(header)
+        && memcmp(header.magic, TB_FILE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == TB_FILE_VERSION
+        && header.piece_count == static_cast<u32>(material.count)
+        && header.entry_count == entry_count(material);
+    for (int i = 0; valid && i < material.count; i++) valid = header.colors[i] == material.colors[i] && header.pieces[i] == material.pieces[i];
+
+    u64 bytes = sizeof(TBFileHeader) + entry_count(material);
+    if (valid) valid = static_cast<u64>(lseek(fd, 0, SEEK_END)) == bytes;
+    if (!valid)
+    {
+        cout << "Error. " << file_name << " is not a " << name(material) << " table for this build." << endl;
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        cout << "Error. Could not map " << file_name << "." << endl;
+        return false;
+    }
+
+    TBTable table;
+    table.material = material;
+    table.key = material_key(material);
+    table.entries = reinterpret_cast<const signed char*>(static_cast<TBFileHeader*>(mapping) + 1);
+    table.entry_count = header.entry_count;
+    table.mapping = mapping;
+    table.mapping_bytes = bytes;
+    tables.push_back(table);
+    return true;
+#endif
+}
+
+int Tablebases::load(string directory)
+{
+    // every table is optional; the ones missing are simply never probed
+    unload();
+    for (TBMaterial& material : all_materials())
+    {
+        string file_name = directory + "/" + name(material) + ".tbt";
+        if (ifstream(file_name).good()) map_table(material, file_name);
+    }
+    return tables.size();
+}
+
+void Tablebases::unload()
+{
+#ifndef _WIN32
+    for (TBTable& table : tables) munmap(table.mapping, table.mapping_bytes);
+#endif
+    tables.clear();
+}
+
+bool Tablebases::generate(string directory)
+{
+    unload();
+    for (TBMaterial& material : all_materials())
+    {
+        string file_name = directory + "/" + name(material) + ".tbt";
+        if (!ifstream(file_name).good() && !generate_table(material, file_name)) return false;
+
+        // later tables probe this one for their captures and promotions
+        if (!map_table(material, file_name)) return false;
+    }
+    return true;
+}
+
+bool Tablebases::generate_table(TBMaterial& material, string file_name)
+{
+    // positions past the table's entries are searched ones: children of double pushes that allow en passant
+    u64 count = entry_count(material);
+    vector<u8> state(count, TB_INVALID);
+    vector<u8> dtm(count, 0);
+    vector<u8> remaining(count, 0);
+    vector<signed char> exits(count, TB_NO_EXIT);
+    vector<u64> searched_parents;
+    vector<pair<u64, u64>> searched_links; // (table entry, searched position that can move to it)
+
+    // highest ply anything is known to resolve at so far
+    int horizon = 0;
+
+    // every move inside the table loses at this ply or sooner; settle on the best way out of it, if any
+    auto exhaust = [&](u64 idx, int ply) {
+        int exit = exits[idx];
+        if (exit > 0) return; // resolves as that win once its ply comes around
+        if (exit == 0)
+        {
+            state[idx] = TB_DRAW;
+            return;
+        }
+        state[idx] = TB_PENDING_LOSS;
+        dtm[idx] = max(ply + 1, exit == TB_NO_EXIT ? 0 : -exit - 1);
+        horizon = max(horizon, static_cast<int>(dtm[idx]));
+    };
+
+    Board board;
+    auto set_board = [&](int* squares, int side_to_move) {
+        u64 occupancies[NUM_COLORS][NUM_PIECES] = {};
+        for (int i = 0; i < material.count; i++) occupancies[material.colors[i]][material.pieces[i]] |= 1ULL << squares[i];
+        board.set_position(occupancies, static_cast<Color>(side_to_move));
+    };
+
+    // mate or stalemate, the values of every capture and promotion, and how many moves stay in the table for the board's position
+    function<bool(u64)> expand = [&](u64 node) {
+        MoveList moves;
+        board.generate_legal_moves(moves);
+        if (moves.count == 0)
+        {
+            state[node] = board.in_check(board.get_side_to_move()) ? TB_LOSS : TB_DRAW;
+            return true;
+        }
+
+        // children that are symmetric copies of each other share an entry, so count each once
+        u64 children[MAX_MOVES];
+        int child_count = 0;
+        int best_exit = TB_NO_EXIT;
+        for (int i = 0; i < moves.count; i++)
+        {
+            Move m = moves.moves[i];
+            PreviousState prev_state = board.make_move(m);
+            if (m.move_type >= CAPTURE)
+            {
+                int value;
+                if (!probe(board, value))
+                {
+                    cout << "Error. " << name(material) << " leads to a table that hasn't been generated." << endl;
+                    return false;
+                }
+                value = flip_value(value);
+                if (best_exit == TB_NO_EXIT || preference(value) > preference(best_exit)) best_exit = value;
+            }
+            else if (m.move_type == DOUBLE_PAWN_PUSH && allows_en_passant(board))
+            {
+                // the child's entry is for the same position without the capture, so search its moves instead
+                u64 searched = state.size();
+                state.push_back(TB_UNKNOWN);
+                dtm.push_back(0);
+                remaining.push_back(0);
+                exits.push_back(TB_NO_EXIT);
+                searched_parents.push_back(node);
+                if (!expand(searched)) return false;
+                children[child_count++] = searched;
+            }
+            else
+            {
+                int child_squares[TB_MAX_PIECES];
+                board_squares(board, material, false, child_squares);
+                children[child_count++] = index(material, child_squares, board.get_side_to_move());
+            }
+            board.unmake_move(m, prev_state);
+        }
+        sort(children, children + child_count);
+        remaining[node] = unique(children, children + child_count) - children;
+        exits[node] = best_exit;
+        if (best_exit > 0) horizon = max(horizon, best_exit);
+        if (remaining[node] == 0) exhaust(node, -1);
+
+        // the retrograde passes reach a searched position through its moves into the table, not by unmaking them
+        if (node >= count)
+        {
+            for (int i = 0; i < remaining[node]; i++)
+            {
+                if (children[i] < count) searched_links.push_back({children[i], node});
+            }
+        }
+        return true;
+    };
+
+    // first pass over every legal, canonical position
+    for (u64 idx = 0; idx < count; idx++)
+    {
+        int squares[TB_MAX_PIECES];
+        int side_to_move;
+        decode(material, idx, squares, side_to_move);
+        if (!is_legal(material, squares, side_to_move) || index(material, squares, side_to_move) != idx) continue;
+        state[idx] = TB_UNKNOWN;
+
+        set_board(squares, side_to_move);
+        if (!expand(idx)) return false;
+    }
+    sort(searched_links.begin(), searched_links.end());
+
+    // retrograde passes, one ply at a time so every distance to mate comes out shortest for the winner
+    u64 node_count = state.size();
+    for (int ply = 0; ply <= horizon; ply++)
+    {
+        // wins by leaving the table, and losses whose last move inside it ran out earlier
+        for (u64 idx = 0; idx < node_count; idx++)
+        {
+            if (state[idx] == TB_UNKNOWN && exits[idx] > 0 && exits[idx] == ply)
+            {
+                state[idx] = TB_WIN;
+                dtm[idx] = ply;
+            }
+            else if (state[idx] == TB_PENDING_LOSS && dtm[idx] == ply) state[idx] = TB_LOSS;
+        }
+
+        for (u64 idx = 0; idx < node_count; idx++)
+        {
+            if ((state[idx] != TB_WIN && state[idx] != TB_LOSS) || dtm[idx] != ply) continue;
+
+            // a searched position only has the parent it was searched from
+            u64 parents[2 * MAX_MOVES];
+            int parent_count = 0;
+            if (idx >= count)
+            {
+                parents[parent_count++] = searched_parents[idx - count];
+            }
+            else
+            {
+                int squares[TB_MAX_PIECES];
+                int side_to_move;
+                decode(material, idx, squares, side_to_move);
+                int mover = side_to_move ^ 1;
+
+                // unmake every non-capturing, non-promoting move the side that just moved could have played
+                u64 occupancy = 0ULL;
+                for (int i = 0; i < material.count; i++) occupancy |= 1ULL << squares[i];
+                for (int i = 0; i < material.count; i++)
+                {
+                    if (material.colors[i] != mover) continue;
+
+                    int sq = squares[i];
+                    u64 from_squares;
+                    switch (material.pieces[i])
+                    {
+                        case pawn:
+                        {
+                            // single and double pushes backwards, never from the back rank
+                            int back = mover == WHITE ? -8 : 8;
+                            int start_rank = mover == WHITE ? rank_2 : rank_7;
+                            from_squares = 0ULL;
+                            int from = sq + back;
+                            if (from / NUM_FILES == rank_1 || from / NUM_FILES == rank_8 || (occupancy & (1ULL << from))) break;
+                            from_squares |= 1ULL << from;
+
+                            // a double push that allows en passant led to a searched position instead of this entry
+                            int start = from + back;
+                            if (start / NUM_FILES == start_rank && !(occupancy & (1ULL << start)))
+                            {
+                                squares[i] = start;
+                                set_board(squares, mover);
+                                squares[i] = sq;
+                                Move push = {static_cast<Square>(start), static_cast<Square>(sq), DOUBLE_PAWN_PUSH};
+                                PreviousState prev_state = board.make_move(push);
+                                if (!allows_en_passant(board)) from_squares |= 1ULL << start;
+                                board.unmake_move(push, prev_state);
+                            }
+                            break;
+                        }
+                        case knight: from_squares = knight_attacks[sq]; break;
+                        case bishop: from_squares = get_bishop_attack(sq, occupancy); break;
+                        case rook: from_squares = get_rook_attack(sq, occupancy); break;
+                        case queen: from_squares = get_queen_attack(sq, occupancy); break;
+                        default: from_squares = king_attacks[sq]; break;
+                    }
+                    from_squares &= ~occupancy;
+
+                    while (from_squares > 0)
+                    {
+                        squares[i] = lsb(from_squares);
+                        if (!attacked(material, squares, squares[side_to_move], mover)) parents[parent_count++] = index(material, squares, mover);
+                        from_squares &= from_squares - 1;
+                    }
+                    squares[i] = sq;
+                }
+
+                // plus the searched positions that can move here
+                auto links = equal_range(searched_links.begin(), searched_links.end(), make_pair(idx, 0ULL), [](const pair<u64, u64>& a, const pair<u64, u64>& b) { return a.first < b.first; });
+                for (auto link = links.first; link != links.second; link++) parents[parent_count++] = link->second;
+            }
+
+            // each parent counted this position once among its children, however many moves lead here
+            sort(parents, parents + parent_count);
+            parent_count = unique(parents, parents + parent_count) - parents;
+            for (int i = 0; i < parent_count; i++)
+            {
+                u64 parent = parents[i];
+                if (state[parent] != TB_UNKNOWN) continue;
+
+                if (state[idx] == TB_LOSS)
+                {
+                    state[parent] = TB_WIN;
+                    dtm[parent] = ply + 1;
+                    horizon = max(horizon, ply + 1);
+                }
+                else if (--remaining[parent] == 0) exhaust(parent, ply);
+            }
+        }
+    }
+
+    // whatever is still unknown can hold out forever
+    vector<signed char> entries(count, 0);
+    u64 wins = 0, losses = 0, draws = 0;
+    int longest = 0;
+    for (u64 idx = 0; idx < count; idx++)
+    {
+        if (state[idx] == TB_WIN)
+        {
+            entries[idx] = dtm[idx];
+            longest = max(longest, static_cast<int>(dtm[idx]));
+            wins++;
+        }
+        else if (state[idx] == TB_LOSS)
+        {
+            entries[idx] = -(dtm[idx] + 1);
+            losses++;
+        }
+        else if (state[idx] != TB_INVALID) draws++;
+    }
+    if (horizon > 126)
+    {
+        cout << "Error. " << name(material) << " has mates too long to store." << endl;
+        return false;
+    }
+
+    ofstream file(file_name, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        cout << "Error. Could not open " << file_name << " for writing." << endl;
+        return false;
+    }
+
+    TBFileHeader header = {};
+    memcpy(header.magic, TB_FILE_MAGIC, sizeof(header.magic));
+    header.version = TB_FILE_VERSION;
+    header.piece_count = material.count;
+    for (int i = 0; i < material.count; i++)
+    {
+        header.colors[i] = material.colors[i];
+        header.pieces[i] = material.pieces[i];
+    }
+    header.entry_count = count;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), count);
+    if (!file.good())
+    {
+        cout << "Error. Could not write " << file_name << "." << endl;
+        return false;
+    }
+
+    cout << name(material) << ": " << wins << " wins, " << losses << " losses, " << draws << " draws, longest mate " << longest << " plies" << endl;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include "board.h"
+
+// a material combination: white king, black king, then white's pieces and black's, strongest first;
+// tables are only built with white as the stronger side, and positions with the colors swapped are probed flipped
+typedef struct TBMaterial {
+    int count;
+    Color colors[TB_MAX_PIECES];
+    Piece pieces[TB_MAX_PIECES];
+} TBMaterial;
+
+// header at the start of a table file; a full cache line, so the entries behind it stay aligned when mapped
+typedef struct alignas(CACHE_LINE_SIZE) TBFileHeader {
+    char magic[8];
+    u32 version;
+    u32 piece_count;
+    u8 colors[TB_MAX_PIECES];
+    u8 pieces[TB_MAX_PIECES];
+    u64 entry_count;
+} TBFileHeader;
+
+// one mapped table; each entry is a signed byte from the side to move's view:
+// 0 draw (or not a legal position), n > 0 mates in n plies, n < 0 is mated in -n - 1 plies
+typedef struct TBTable {
+    TBMaterial material;
+    u64 key;
+    const signed char* entries;
+    u64 entry_count;
+    void* mapping;
+    u64 mapping_bytes;
+} TBTable;
+
+class Tablebases
+{
+    private:
+        // mapped read-only and shared by every search
+        static vector<TBTable> tables;
+
+        static TBTable* find(Board& board, bool& flipped);
+        static bool map_table(TBMaterial& material, string file_name);
+        static bool generate_table(TBMaterial& material, string file_name);
+    public:
+        // map every table found in the directory; returns how many were mapped
+        static int load(string directory);
+        static void unload();
+        static int get_table_count() { return tables.size(); }
+
+        // value of the position for the side to move, if a table covers it
+        static bool probe(Board& board, int& value);
+
+        // table value -> search score at this ply
+        static int to_score(int value, int ply);
+
+        // retrograde generation of every 3- and 4-man table into the directory; tables already there are kept
+        static bool generate(string directory);
+
+        // entry layout shared by generation and probing
+        static u64 entry_count(TBMaterial& material);
+        static u64 index(TBMaterial& material, int* squares, int side_to_move);
+        static string name(TBMaterial& material);
+};
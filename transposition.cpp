@@ -1,56 +1,343 @@
 #include "transposition.h"
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// entries live in the table as plain words; these convert between the word and its fields
+static TTEntry load_entry(const std::atomic<u64>& slot)
+{
+    u64 word = slot.load(std::memory_order_relaxed);
+    TTEntry entry;
+    memcpy(&entry, &word, sizeof(entry));
+    return entry;
+}
+
+static void store_entry(std::atomic<u64>& slot, const TTEntry& entry)
+{
+    u64 word;
+    memcpy(&word, &entry, sizeof(word));
+    slot.store(word, std::memory_order_relaxed);
+}
+
+// allocates a block of clusters for the table, or returns nullptr if there isn't the memory for it
+static TTCluster* allocate_clusters(u64 bytes)
+{
+    // align to cache lines, and to huge pages once the table is big enough to use them
+    u64 alignment = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+#ifdef _WIN32
+    TTCluster* block = static_cast<TTCluster*>(_aligned_malloc(bytes, alignment));
+#else
+    TTCluster* block = static_cast<TTCluster*>(aligned_alloc(alignment, bytes));
+#endif
+
+    // ask for transparent huge pages to cut tlb misses on random probes
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (block != nullptr && alignment == HUGE_PAGE_SIZE) madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+
+    return block;
+}
+
+void TranspositionTable::resize(u64 megabytes)
+{
+    // largest power-of-two number of clusters that fits in the requested size
+    u64 requested_count = 1ULL << msb(max(megabytes, 1ULL) * 1024 * 1024 / sizeof(TTCluster));
+
+    // halve the size until the allocation succeeds
+    u64 new_count = requested_count;
+    TTCluster* new_clusters = allocate_clusters(new_count * sizeof(TTCluster));
+    while (new_clusters == nullptr && new_count > 1)
+    {
+        new_count /= 2;
+        new_clusters = allocate_clusters(new_count * sizeof(TTCluster));
+    }
+
+    // if not even one cluster fits, keep whatever table we already have
+    if (new_clusters == nullptr)
+    {
+        cout << "Error. Could not allocate a transposition table, keeping the current one." << endl;
+        return;
+    }
+    if (new_count < requested_count)
+    {
+        cout << "Error. Could not allocate " << megabytes << " MB for the transposition table, using " << new_count * sizeof(TTCluster) / 1024 << " KB instead." << endl;
+    }
+
+    free_table();
+    clusters = new_clusters;
+    cluster_count = new_count;
+    index_mask = cluster_count - 1;
+
+    clear_table();
+}
+
+void TranspositionTable::free_table()
+{
+    if (clusters == nullptr) return;
+#ifndef _WIN32
+    // a mapped table goes back to its file, along with the generation it has reached
+    if (mapped_header != nullptr)
+    {
+        mapped_header->generation = generation;
+        munmap(mapped_header, mapped_bytes);
+        mapped_header = nullptr;
+        clusters = nullptr;
+        return;
+    }
+#endif
+#ifdef _WIN32
+    _aligned_free(clusters);
+#else
+    free(clusters);
+#endif
+    clusters = nullptr;
+}
 
 void TranspositionTable::clear_table()
 {
-    // zero out everything
-    for (int i = 0; i < TT_ENTRIES; i++)
+    // zero out everything, splitting the table into contiguous slices of at least a huge page per thread
+    u64 bytes = cluster_count * sizeof(TTCluster);
+    u64 thread_count = max(1ULL, min(static_cast<u64>(thread::hardware_concurrency()), bytes / HUGE_PAGE_SIZE));
+    u64 slice = (cluster_count + thread_count - 1) / thread_count;
+
+    vector<thread> threads;
+    for (u64 start = 0; start < cluster_count; start += slice)
     {
-        entries[i].hash = 0;
-        entries[i].best_move = {null, null, QUIET};
-        entries[i].node_type = EXACT;
-        entries[i].score = 0;
-        entries[i].depth = -1;
+        u64 count = min(slice, cluster_count - start);
+        threads.emplace_back([this, start, count]() { memset(static_cast<void*>(clusters + start), 0, count * sizeof(TTCluster)); });
     }
+    for (thread& t : threads) t.join();
+
+    generation = 0;
 }
 
-void TranspositionTable::add(u64 hash, Move best_move, TTFlag node_type, int score, int depth, int ply)
+TTStore TranspositionTable::add(u64 hash, Move best_move, TTFlag node_type, int score, int depth, int ply)
 {
-    u64 index = hash % TT_ENTRIES;
-    TTEntry& entry = entries[index];
+    // if score is time-control score (or otherwise outside the mate range), don't add entry
+    if (abs(score) > CHECKMATE_SCORE) return STORE_SKIPPED;
 
-    // if score is time-control score, don't add entry
-    if ((abs(score) == TIME_SCORE)) return;
+    // reuse this position's slot if it has one; otherwise evict the entry that is stalest and shallowest
+    u16 key = hash >> 48;
+    TTCluster& cluster = clusters[hash & index_mask];
+    int replace = 0;
+    int replace_value = MAX_BOUND;
+    TTStore result = STORE_EMPTY;
+    for (int i = 0; i < TT_CLUSTER_SIZE; i++)
+    {
+        TTEntry entry = load_entry(cluster.entries[i]);
+        if (entry.key == key && entry.depth > 0)
+        {
+            replace = i;
+            result = STORE_SAME_POSITION;
+            break;
+        }
 
-    // follow always-replace scheme
-    entry.hash = hash;
-    entry.best_move = best_move;
-    entry.node_type = node_type;
+        // each generation of age counts as much as 8 plies of depth
+        int entry_age = (generation - (entry.bound_generation >> 2)) & 63;
+        int entry_value = entry.depth - 8 * entry_age;
+        if (entry_value < replace_value)
+        {
+            replace = i;
+            replace_value = entry_value;
+            if (entry.depth == 0) result = STORE_EMPTY;
+            else if (entry_age > 0) result = STORE_REPLACE_STALE;
+            else result = STORE_REPLACE_SHALLOW;
+        }
+    }
 
     // apply special logic for mating scores
     if (is_mate_score(score))
     {
-        if (score < 0) entry.score = score - ply;
-        else entry.score = score + ply;
+        if (score < 0) score -= ply;
+        else score += ply;
     }
-    else entry.score = score;
-    
-    entry.depth = depth;
+
+    // build the entry off to the side and publish it with one store; a racing writer may win the slot, but never half of it
+    TTEntry entry;
+    entry.key = key;
+    entry.move = encode_move(best_move);
+    entry.score = score;
+    entry.depth = min(depth + 1, 255);
+    entry.bound_generation = node_type | (generation << 2);
+    store_entry(cluster.entries[replace], entry);
+    return result;
 }
 
-TTEntry TranspositionTable::probe(u64 hash, int ply)
+TTData TranspositionTable::probe(u64 hash, int ply)
 {
-    TTEntry entry = entries[hash % TT_ENTRIES];
+    // scan the position's cluster for a matching key
+    u16 key = hash >> 48;
+    TTCluster& cluster = clusters[hash & index_mask];
+    for (int i = 0; i < TT_CLUSTER_SIZE; i++)
+    {
+        TTEntry entry = load_entry(cluster.entries[i]);
+        if (entry.key != key || entry.depth == 0) continue;
 
-    // check if hash matches
-    if (entry.hash != hash) return {0, {null, null, QUIET}, EXACT, 0, -1};
+        TTData data = {decode_move(entry.move), static_cast<TTFlag>(entry.bound_generation & 3), entry.score, entry.depth - 1};
 
-    // normalize mating scores
-    if (is_mate_score(entry.score))
+        // normalize mating scores
+        if (is_mate_score(data.score))
+        {
+            if (data.score < 0) data.score += ply;
+            else data.score -= ply;
+        }
+
+        // return entry
+        return data;
+    }
+
+    return {{null, null, QUIET}, EXACT, 0, -1};
+}
+
+int TranspositionTable::hashfull()
+{
+    // per-mille of entries written this search, sampled from the first clusters
+    u64 sample = min(cluster_count, 1000ULL);
+    u64 used = 0;
+    for (u64 i = 0; i < sample; i++)
     {
-        if (entry.score < 0) entry.score += ply;
-        else entry.score -= ply;
+        for (int j = 0; j < TT_CLUSTER_SIZE; j++)
+        {
+            TTEntry entry = load_entry(clusters[i].entries[j]);
+            if (entry.depth > 0 && (entry.bound_generation >> 2) == generation) used++;
+        }
     }
 
-    // return entry
-    return entry;
+    return used * 1000 / (sample * TT_CLUSTER_SIZE);
+}
+
+// magic bytes identifying a table snapshot
+static const char TT_FILE_MAGIC[8] = {'T', 'B', 'O', 'L', 'T', 'T', 'T', '\0'};
+
+bool TranspositionTable::save(string file_name)
+{
+    ofstream file(file_name, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        cout << "Error. Could not open " << file_name << " for writing." << endl;
+        return false;
+    }
+
+    // header, then the clusters exactly as they sit in memory
+    TTFileHeader header = {};
+    memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+    header.version = TT_FILE_VERSION;
+    header.cluster_size = sizeof(TTCluster);
+    header.cluster_count = cluster_count;
+    header.zobrist_fingerprint = zobrist_fingerprint();
+    header.generation = generation;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(clusters), cluster_count * sizeof(TTCluster));
+    return file.good();
+}
+
+bool TranspositionTable::map_file(string file_name)
+{
+#ifdef _WIN32
+    cout << "Error. Mapping table snapshots is not supported on this platform." << endl;
+    return false;
+#else
+    int fd = open(file_name.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+        cout << "Error. Could not open " << file_name << "." << endl;
+        return false;
+    }
+
+    // check the header before trusting anything behind it
+    TTFileHeader header;
+    bool valid = read(fd, &header, sizeof(header)) == sizeof(header)
+        && memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == TT_FILE_VERSION
+        && header.cluster_size == sizeof(TTCluster)
+        && header.cluster_count > 0 && (header.cluster_count & (header.cluster_count - 1)) == 0
+        && header.zobrist_fingerprint == zobrist_fingerprint();
+
+    u64 bytes = sizeof(TTFileHeader) + header.cluster_count * sizeof(TTCluster);
+    if (valid) valid = static_cast<u64>(lseek(fd, 0, SEEK_END)) == bytes;
+    if (!valid)
+    {
+        cout << "Error. " << file_name << " is not a table snapshot for this build." << endl;
+        close(fd);
+        return false;
+    }
+
+    // map it shared, so the search keeps writing its results back to the file
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        cout << "Error. Could not map " << file_name << "." << endl;
+        return false;
+    }
+
+    free_table();
+    mapped_header = static_cast<TTFileHeader*>(mapping);
+    mapped_bytes = bytes;
+    clusters = reinterpret_cast<TTCluster*>(mapped_header + 1);
+    cluster_count = header.cluster_count;
+    index_mask = cluster_count - 1;
+    generation = header.generation;
+    return true;
+#endif
+}
+
+bool test_transposition()
+{
+    // a small table, so the threads keep colliding on the same clusters
+    TranspositionTable tt;
+    tt.resize(1);
+
+    // 16 keys share each cluster, more than it holds; everything stored for a position follows from its hash
+    auto position_hash = [](u64 random) { return ((random >> 14) & 0xF) << 48 | (random & 0x3FFF); };
+    auto position_move = [](u64 hash) { return Move{static_cast<Square>((hash >> 48) % 64), static_cast<Square>(hash % 63 + 1), static_cast<MoveType>((hash >> 6) % 4)}; };
+    auto position_score = [](u64 hash) { return static_cast<int>(((hash >> 48) ^ hash) % 2000) - 1000; };
+    auto position_depth = [](u64 hash) { return static_cast<int>(((hash >> 50) + hash) % 32); };
+
+    // half the operations add, half probe; a torn or mixed entry shows up as a hit whose fields disagree
+    std::atomic<u64> hits(0);
+    std::atomic<u64> corrupt(0);
+    int thread_count = max(4, static_cast<int>(thread::hardware_concurrency()));
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            u64 random = 0x9E3779B97F4A7C15ULL * (t + 1);
+            for (int i = 0; i < 500000; i++)
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+                u64 hash = position_hash(random);
+
+                if (i & 1)
+                {
+                    tt.add(hash, position_move(hash), static_cast<TTFlag>(hash % 3), position_score(hash), position_depth(hash), 0);
+                    continue;
+                }
+
+                TTData data = tt.probe(hash, 0);
+                if (data.depth < 0) continue;
+                hits++;
+                if (!same_move(data.best_move, position_move(hash)) || data.node_type != static_cast<TTFlag>(hash % 3) || data.score != position_score(hash) || data.depth != position_depth(hash)) corrupt++;
+            }
+        });
+    }
+    for (thread& t : threads) t.join();
+
+    bool result = hits > 0 && corrupt == 0;
+    if (result == false) cout << "TRANSPOSITION STRESS FAILED: " << corrupt << " corrupt entries in " << hits << " hits." << endl;
+    else cout << "TRANSPOSITION STRESS PASSED: " << hits << " hits from " << thread_count << " threads." << endl;
+
+    return result;
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 #include "move.h"
+#include <atomic>
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
 
 typedef enum TTFlag {
     EXACT,
@@ -7,23 +11,93 @@ typedef enum TTFlag {
     UPPER_BOUND
 } TTFlag;
 
+// packed 8-byte entry: upper 16 hash bits, encoded move, score, depth + 1 (0 = empty), bound in the low 2 bits and generation in the upper 6
 typedef struct TTEntry {
-    u64 hash;
+    u16 key;
+    u16 move;
+    short score;
+    u8 depth;
+    u8 bound_generation;
+} TTEntry;
+
+static_assert(sizeof(TTEntry) == sizeof(u64), "a tt entry must fit in one atomic word");
+
+// entries sharing one cache line; a probe only ever touches one cluster
+// each entry is read and written as a single 64-bit word, so threads sharing the table never see a torn entry
+typedef struct alignas(CACHE_LINE_SIZE) TTCluster {
+    std::atomic<u64> entries[TT_CLUSTER_SIZE];
+} TTCluster;
+
+// what an add did with its cluster, for telemetry
+typedef enum TTStore {
+    STORE_SKIPPED,
+    STORE_EMPTY,
+    STORE_SAME_POSITION,
+    STORE_REPLACE_STALE,
+    STORE_REPLACE_SHALLOW,
+    NUM_TT_STORES
+} TTStore;
+
+// header at the start of a saved table; a full cache line, so the clusters behind it stay aligned when mapped
+typedef struct alignas(CACHE_LINE_SIZE) TTFileHeader {
+    char magic[8];
+    u32 version;
+    u32 cluster_size;
+    u64 cluster_count;
+    u64 zobrist_fingerprint;
+    u8 generation;
+} TTFileHeader;
+
+// unpacked result of a probe
+typedef struct TTData {
     Move best_move;
     TTFlag node_type;
     int score;
     int depth;
-
-} TTEntry;
+} TTData;
 
 class TranspositionTable
 {
     private:
-        TTEntry* entries;
+        // power-of-two sized, so a probe indexes with a mask instead of a division
+        TTCluster* clusters;
+        u64 cluster_count;
+        u64 index_mask;
+
+        // bumped once per search so entries from earlier searches can be recognized as stale (6 bits are stored)
+        u8 generation;
+
+        // header of the snapshot file the clusters are mapped from, or nullptr when they were allocated
+        TTFileHeader* mapped_header;
+        u64 mapped_bytes;
+
+        void free_table();
     public:
-        TranspositionTable() { entries = new TTEntry[TT_ENTRIES]; }
-        ~TranspositionTable() { delete[] entries; }
+        TranspositionTable() { clusters = nullptr; mapped_header = nullptr; generation = 0; resize(DEFAULT_TT_MB); }
+        ~TranspositionTable() { free_table(); }
+        void resize(u64 megabytes);
+        u64 get_entry_count() { return cluster_count * TT_CLUSTER_SIZE; }
+        // a new search only ages the table; clear_table is for when nothing in it should survive, e.g. a new game
+        void new_search() { generation = (generation + 1) & 63; }
         void clear_table();
-        void add(u64 hash, Move best_move, TTFlag node_type, int score, int depth, int ply);
-        TTEntry probe(u64 hash, int ply);
-};
\ No newline at end of file
+        TTStore add(u64 hash, Move best_move, TTFlag node_type, int score, int depth, int ply);
+        TTData probe(u64 hash, int ply);
+        int hashfull();
+
+        // snapshots: save writes the table to a file, map_file replaces the table with a read-write mapping of one
+        bool save(string file_name);
+        bool map_file(string file_name);
+
+        // start pulling a position's cluster into cache so a later probe doesn't stall on memory
+        void prefetch(u64 hash)
+        {
+#ifdef _MSC_VER
+            _mm_prefetch(reinterpret_cast<const char*>(&clusters[hash & index_mask]), _MM_HINT_T0);
+#else
+            __builtin_prefetch(&clusters[hash & index_mask]);
+#endif
+        }
+};
+
+// testing suite for the transposition table: threads add and probe the same positions, and every hit must be an entry one of them wrote whole
+bool test_transposition();
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "tuner.h"
+#include "moveorder.h"
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#define NUM_EVAL_PARAMS (sizeof(EvalParams) / sizeof(int))
+#define NUM_TRACE_TERMS (sizeof(EvalTrace) / sizeof(int))
+#define TUNER_BATCH_SIZE 16384
+#define TUNER_LEARNING_RATE 1.0
+#define TUNER_LOAD_CHUNK 65536
+
+// where each term of the trace lands in the params, as offsets into the structs
+typedef struct TunerTerm {
+    size_t trace;
+    size_t mg;
+    size_t eg;
+    int length;
+} TunerTerm;
+
+static const TunerTerm tuner_terms[] = {
+    {offsetof(EvalTrace, piece_scores), offsetof(EvalParams, mg_piece_scores), offsetof(EvalParams, eg_piece_scores), NUM_PIECES},
+    {offsetof(EvalTrace, psqt), offsetof(EvalParams, mg_psqt), offsetof(EvalParams, eg_psqt), NUM_PIECES * NUM_SQUARES},
+    {offsetof(EvalTrace, doubled_pawn), offsetof(EvalParams, mg_doubled_pawn), offsetof(EvalParams, eg_doubled_pawn), 1},
+    {offsetof(EvalTrace, isolated_pawn), offsetof(EvalParams, mg_isolated_pawn), offsetof(EvalParams, eg_isolated_pawn), 1},
+    {offsetof(EvalTrace, backward_pawn), offsetof(EvalParams, mg_backward_pawn), offsetof(EvalParams, eg_backward_pawn), 1},
+    {offsetof(EvalTrace, passed_pawn), offsetof(EvalParams, mg_passed_pawn), offsetof(EvalParams, eg_passed_pawn), NUM_RANKS},
+    {offsetof(EvalTrace, mobility), offsetof(EvalParams, mg_mobility), offsetof(EvalParams, eg_mobility), NUM_PIECES},
+    {offsetof(EvalTrace, king_attack), offsetof(EvalParams, mg_king_attack), offsetof(EvalParams, eg_king_attack), NUM_PIECES}
+};
+
+// flattened trace index -> flattened params index, for both halves of each term
+static int mg_index[NUM_TRACE_TERMS];
+static int eg_index[NUM_TRACE_TERMS];
+
+static void map_terms()
+{
+    int mapped = 0;
+    for (const TunerTerm& term : tuner_terms)
+    {
+        for (int i = 0; i < term.length; i++)
+        {
+            int t = term.trace / sizeof(int) + i;
+            mg_index[t] = term.mg / sizeof(int) + i;
+            eg_index[t] = term.eg / sizeof(int) + i;
+        }
+        mapped += term.length;
+    }
+    if (mapped != NUM_TRACE_TERMS) cout << "Error. Tuner terms don't cover the eval trace." << endl;
+}
+
+// captures-only search like the engine's quiescence, but keeping the line so the quiet leaf can be replayed
+static int resolve(Board& board, Evaluator& evaluator, int alpha, int beta, int ply, Move* pv, int& pv_length)
+{
+    pv_length = 0;
+    bool early_exit;
+    int stand_pat = evaluator.eval(board, alpha, beta, early_exit);
+    if (stand_pat >= beta || ply >= MAX_PLY - 1) return stand_pat;
+    alpha = max(alpha, stand_pat);
+
+    // only captures are searched, so only they need ordering
+    MoveList moves;
+    MoveList captures;
+    board.generate_pseudo_legal_moves(moves);
+    for (int i = 0; i < moves.count; i++)
+    {
+        Move m = moves.moves[i];
+        if (m.move_type == CAPTURE || m.move_type == EN_PASSANT_CAPTURE || m.move_type >= KNIGHT_PROMOTION_CAPTURE) captures.add(m);
+    }
+    order_moves(board, captures, {true, true, false}, {null, null, QUIET});
+
+    Move child_pv[MAX_PLY];
+    int child_length;
+    for (int i = 0; i < captures.count; i++)
+    {
+        Move m = captures.moves[i];
+        PreviousState prev = board.make_move(m);
+        if (board.in_check(static_cast<Color>(1 - board.get_side_to_move())))
+        {
+            board.unmake_move(m, prev);
+            continue;
+        }
+        int score = -resolve(board, evaluator, -beta, -alpha, ply + 1, child_pv, child_length);
+        board.unmake_move(m, prev);
+
+        if (score > alpha)
+        {
+            alpha = score;
+            pv[0] = m;
+            for (int j = 0; j < child_length; j++) pv[j + 1] = child_pv[j];
+            pv_length = child_length + 1;
+            if (alpha >= beta) break;
+        }
+    }
+
+    return alpha;
+}
+
+// split "fen result" into a full six-field fen and a result from white's side; false if the line has no result
+static bool parse_line(string line, string& fen, float& result)
+{
+    if (line.find("1/2-1/2") != string::npos) result = 0.5;
+    else if (line.find("1-0") != string::npos) result = 1.0;
+    else if (line.find("0-1") != string::npos) result = 0.0;
+    else
+    {
+        size_t open = line.find('[');
+        if (open == string::npos) return false;
+        result = stof(line.substr(open + 1));
+    }
+
+    // the first four fields are always there; move counters are optional in most datasets
+    stringstream tokens(line);
+    string field;
+    fen = "";
+    for (int i = 0; i < 6 && tokens >> field; i++)
+    {
+        if (i >= 4 && field.find_first_not_of("0123456789") != string::npos) break;
+        fen += (i > 0 ? " " : "") + field;
+        if (i == 5) return true;
+    }
+    if (count(fen.begin(), fen.end(), ' ') == 3) fen += " 0 1";
+    else if (count(fen.begin(), fen.end(), ' ') == 4) fen += " 1";
+    return count(fen.begin(), fen.end(), ' ') == 5;
+}
+
+Tuner::Tuner(int threads)
+{
+    thread_count = max(1, threads);
+    k = 1.0;
+    map_terms();
+}
+
+bool Tuner::load(string file_name)
+{
+    ifstream file(file_name);
+    if (!file.is_open())
+    {
+        cout << "Error. Could not open " << file_name << "." << endl;
+        return false;
+    }
+
+    positions.clear();
+    coefficients.clear();
+
+    // read a chunk of lines at a time, so only the compact positions and coefficients outlive it
+    vector<string> lines;
+    vector<vector<TunerPosition>> thread_positions(thread_count);
+    vector<vector<TunerCoefficient>> thread_coefficients(thread_count);
+    u64 line_count = 0;
+    string line;
+    while (file)
+    {
+        lines.clear();
+        while (lines.size() < TUNER_LOAD_CHUNK && getline(file, line)) if (!line.empty()) lines.push_back(line);
+        if (lines.empty()) break;
+        line_count += lines.size();
+
+        // each thread resolves a contiguous slice with its own evaluator, then the slices are stitched together in order
+        u64 slice = (lines.size() + thread_count - 1) / thread_count;
+        vector<thread> threads;
+        for (int t = 0; t < thread_count; t++)
+        {
+            thread_positions[t].clear();
+            thread_coefficients[t].clear();
+            threads.emplace_back([&, t]()
+            {
+                Evaluator evaluator;
+                EvalTrace trace;
+                Board board;
+                Move pv[MAX_PLY];
+                int pv_length;
+
+                for (u64 i = t * slice; i < min(static_cast<u64>(lines.size()), (t + 1) * slice); i++)
+                {
+                    string fen;
+                    float result;
+                    if (!parse_line(lines[i], fen, result)) continue;
+                    board.from_fen(fen);
+                    if (board.in_check(static_cast<Color>(1 - board.get_side_to_move()))) continue;
+
+                    // walk down to the position quiescence would have scored, and count its terms
+                    resolve(board, evaluator, -MAX_BOUND, MAX_BOUND, 0, pv, pv_length);
+                    for (int j = 0; j < pv_length; j++) board.make_move(pv[j]);
+                    trace = {};
+                    evaluator.set_trace(&trace);
+                    evaluator.eval(board);
+                    evaluator.set_trace(nullptr);
+
+                    TunerPosition position = {static_cast<float>(min(board.get_phase(), TOTAL_PHASE)) / TOTAL_PHASE, result, static_cast<u32>(thread_coefficients[t].size()), 0};
+                    int* counts = reinterpret_cast<int*>(&trace);
+                    for (u16 j = 0; j < NUM_TRACE_TERMS; j++)
+                    {
+                        if (counts[j] == 0) continue;
+                        thread_coefficients[t].push_back({j, static_cast<short>(counts[j])});
+                        position.coefficient_count++;
+                    }
+                    thread_positions[t].push_back(position);
+                }
+            });
+        }
+        for (thread& t : threads) t.join();
+
+        for (int t = 0; t < thread_count; t++)
+        {
+            u32 offset = coefficients.size();
+            for (TunerPosition& position : thread_positions[t])
+            {
+                position.first_coefficient += offset;
+                positions.push_back(position);
+            }
+            coefficients.insert(coefficients.end(), thread_coefficients[t].begin(), thread_coefficients[t].end());
+        }
+    }
+
+    cout << "Loaded " << positions.size() << " of " << line_count << " positions from " << file_name << "." << endl;
+    return !positions.empty();
+}
+
+// eval from white's side as a linear function of the params
+static double linear_eval(TunerPosition& position, TunerCoefficient* coefficients, vector<double>& params)
+{
+    double mg = 0.0;
+    double eg = 0.0;
+    for (int i = 0; i < position.coefficient_count; i++)
+    {
+        mg += coefficients[i].count * params[mg_index[coefficients[i].index]];
+        eg += coefficients[i].count * params[eg_index[coefficients[i].index]];
+    }
+    return eg + (mg - eg) * position.mg_weight;
+}
+
+static double sigmoid(double k, double eval)
+{
+    return 1.0 / (1.0 + pow(10.0, -k * eval / 400.0));
+}
+
+double Tuner::error(vector<double>& params)
+{
+    vector<double> sums(thread_count, 0.0);
+    u64 slice = (positions.size() + thread_count - 1) / thread_count;
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (u64 i = t * slice; i < min(static_cast<u64>(positions.size()), (t + 1) * slice); i++)
+            {
+                TunerPosition& position = positions[i];
+                double diff = position.result - sigmoid(k, linear_eval(position, &coefficients[position.first_coefficient], params));
+                sums[t] += diff * diff;
+            }
+        });
+    }
+    for (thread& t : threads) t.join();
+
+    double sum = 0.0;
+    for (double s : sums) sum += s;
+    return sum / positions.size();
+}
+
+void Tuner::gradient(vector<double>& params, vector<int>& order, int first, int count, vector<double>& grad)
+{
+    vector<vector<double>> thread_grads(thread_count, vector<double>(NUM_EVAL_PARAMS, 0.0));
+    int slice = (count + thread_count - 1) / thread_count;
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            vector<double>& local = thread_grads[t];
+            for (int i = first + t * slice; i < first + min(count, (t + 1) * slice); i++)
+            {
+                TunerPosition& position = positions[order[i]];
+                TunerCoefficient* coefs = &coefficients[position.first_coefficient];
+                double s = sigmoid(k, linear_eval(position, coefs, params));
+
+                // d(result - s)^2 / d eval, spread over the mg and eg param of every term by phase
+                double g = -2.0 * (position.result - s) * s * (1.0 - s) * k * log(10.0) / 400.0;
+                for (int j = 0; j < position.coefficient_count; j++)
+                {
+                    local[mg_index[coefs[j].index]] += g * coefs[j].count * position.mg_weight;
+                    local[eg_index[coefs[j].index]] += g * coefs[j].count * (1.0 - position.mg_weight);
+                }
+            }
+        });
+    }
+    for (thread& t : threads) t.join();
+
+    for (u64 j = 0; j < NUM_EVAL_PARAMS; j++)
+    {
+        grad[j] = 0.0;
+        for (int t = 0; t < thread_count; t++) grad[j] += thread_grads[t][j];
+        grad[j] /= count;
+    }
+}
+
+EvalParams Tuner::tune(EvalParams start, int epochs)
+{
+    vector<double> params(NUM_EVAL_PARAMS);
+    int* start_values = reinterpret_cast<int*>(&start);
+    for (u64 i = 0; i < NUM_EVAL_PARAMS; i++) params[i] = start_values[i];
+
+    // fit the scaling to the starting params first, so tuning moves the params rather than the curve
+    double best_k = k;
+    double best_error = 1e9;
+    for (double candidate = 0.1; candidate <= 3.0; candidate += 0.05)
+    {
+        k = candidate;
+        double e = error(params);
+        if (e < best_error)
+        {
+            best_error = e;
+            best_k = candidate;
+        }
+    }
+    k = best_k;
+    cout << "K: " << k << ", starting error: " << best_error << endl;
+
+    // adam over shuffled mini-batches
+    vector<double> m(NUM_EVAL_PARAMS, 0.0);
+    vector<double> v(NUM_EVAL_PARAMS, 0.0);
+    vector<double> grad(NUM_EVAL_PARAMS, 0.0);
+    vector<int> order(positions.size());
+    for (u64 i = 0; i < positions.size(); i++) order[i] = i;
+    mt19937 rng;
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    int step = 0;
+
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        shuffle(order.begin(), order.end(), rng);
+        for (int first = 0; first < static_cast<int>(order.size()); first += TUNER_BATCH_SIZE)
+        {
+            gradient(params, order, first, min(TUNER_BATCH_SIZE, static_cast<int>(order.size()) - first), grad);
+            step++;
+            for (u64 j = 0; j < NUM_EVAL_PARAMS; j++)
+            {
+                m[j] = beta1 * m[j] + (1.0 - beta1) * grad[j];
+                v[j] = beta2 * v[j] + (1.0 - beta2) * grad[j] * grad[j];
+                double m_hat = m[j] / (1.0 - pow(beta1, step));
+                double v_hat = v[j] / (1.0 - pow(beta2, step));
+                params[j] -= TUNER_LEARNING_RATE * m_hat / (sqrt(v_hat) + 1e-8);
+            }
+        }
+        cout << "Epoch: " << epoch << ", error: " << error(params) << endl;
+    }
+
+    EvalParams tuned = start;
+    int* tuned_values = reinterpret_cast<int*>(&tuned);
+    for (u64 i = 0; i < NUM_EVAL_PARAMS; i++) tuned_values[i] = static_cast<int>(round(params[i]));
+    return tuned;
+}
+
+static void print_array(string name, const int* values, int length, int per_line)
+{
+    cout << name << " = {";
+    for (int i = 0; i < length; i++)
+    {
+        if (per_line > 0 && i % per_line == 0) cout << endl << "    ";
+        cout << values[i];
+        if (i + 1 < length) cout << (per_line > 0 && (i + 1) % per_line == 0 ? "," : ", ");
+    }
+    cout << (per_line > 0 ? "\n}" : "}") << endl;
+}
+
+void Tuner::print_params(EvalParams& params)
+{
+    print_array("mg_piece_scores", params.mg_piece_scores, NUM_PIECES, 0);
+    print_array("eg_piece_scores", params.eg_piece_scores, NUM_PIECES, 0);
+    for (int piece = 0; piece < NUM_PIECES; piece++) print_array("mg_psqt[" + to_string(piece) + "]", params.mg_psqt[piece], NUM_SQUARES, NUM_FILES);
+    for (int piece = 0; piece < NUM_PIECES; piece++) print_array("eg_psqt[" + to_string(piece) + "]", params.eg_psqt[piece], NUM_SQUARES, NUM_FILES);
+    cout << "mg_doubled_pawn = " << params.mg_doubled_pawn << ", eg_doubled_pawn = " << params.eg_doubled_pawn << endl;
+    cout << "mg_isolated_pawn = " << params.mg_isolated_pawn << ", eg_isolated_pawn = " << params.eg_isolated_pawn << endl;
+    cout << "mg_backward_pawn = " << params.mg_backward_pawn << ", eg_backward_pawn = " << params.eg_backward_pawn << endl;
+    print_array("mg_passed_pawn", params.mg_passed_pawn, NUM_RANKS, 0);
+    print_array("eg_passed_pawn", params.eg_passed_pawn, NUM_RANKS, 0);
+    print_array("mg_mobility", params.mg_mobility, NUM_PIECES, 0);
+    print_array("eg_mobility", params.eg_mobility, NUM_PIECES, 0);
+    print_array("mg_king_attack", params.mg_king_attack, NUM_PIECES, 0);
+    print_array("eg_king_attack", params.eg_king_attack, NUM_PIECES, 0);
+}
\ No newline at end of file
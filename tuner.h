@@ -0,0 +1,41 @@
+#pragma once
+#include "evaluate.h"
+
+// one labelled position, reduced to the eval terms of its quiet leaf; the counts live in a pool shared by every position
+typedef struct TunerPosition {
+    float mg_weight; // phase / TOTAL_PHASE, so the eg params get the rest
+    float result; // from white's side: 1 win, 0.5 draw, 0 loss
+    u32 first_coefficient;
+    u16 coefficient_count;
+} TunerPosition;
+
+// a nonzero count of one term, indexing the trace flattened into ints
+typedef struct TunerCoefficient {
+    u16 index;
+    short count;
+} TunerCoefficient;
+
+// texel tuning: fit EvalParams to game results by minimizing the squared error of a logistic of the eval
+class Tuner
+{
+    private:
+        vector<TunerPosition> positions;
+        vector<TunerCoefficient> coefficients;
+        int thread_count;
+
+        // scaling of the logistic that maps an eval to an expected result
+        double k;
+
+        double error(vector<double>& params);
+        void gradient(vector<double>& params, vector<int>& order, int first, int count, vector<double>& grad);
+    public:
+        Tuner(int threads);
+
+        // read "fen result" lines, resolve each position with quiescence and keep its leaf's term counts
+        bool load(string file_name);
+
+        // pick the logistic scaling that best fits the starting params, then run adam over mini-batches
+        EvalParams tune(EvalParams start, int epochs);
+
+        static void print_params(EvalParams& params);
+};
\ No newline at end of file